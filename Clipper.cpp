@@ -0,0 +1,207 @@
+#include "Clipper.h"
+#include <math.h>
+#include <algorithm>
+
+ClipWindow ClipWindow::inflated(int margin) const
+{
+	ClipWindow bound = unbounded();
+	ClipWindow window;
+	window.xmin = (int)std::max<long long>((long long)xmin - margin, bound.xmin);
+	window.ymin = (int)std::max<long long>((long long)ymin - margin, bound.ymin);
+	window.xmax = (int)std::min<long long>((long long)xmax + margin, bound.xmax);
+	window.ymax = (int)std::min<long long>((long long)ymax + margin, bound.ymax);
+	return window;
+}
+
+bool Clipper::getViewportWindow(ClipWindow& window)
+{
+	int x = 0, y = 0, width, height, pitch;
+	if (!getClipRect(x, y, width, height))
+	{
+		if (getFrameBuffer(width, height, pitch) == NULL)
+		{
+			width = getWindowWidth();
+			height = getWindowHeight();
+		}
+	}
+	if (width <= 0 || height <= 0) return false;
+
+	window = getDeviceWindow(x, y, width, height);
+	return true;
+}
+
+ClipWindow Clipper::getDeviceWindow(int x, int y, int width, int height)
+{
+	int lx0, ly0, lx1, ly1;
+	DPtToLPt(x, y, lx0, ly0);
+	DPtToLPt(x + width - 1, y + height - 1, lx1, ly1);
+	ClipWindow window;
+	window.xmin = std::min(lx0, lx1);
+	window.xmax = std::max(lx0, lx1);
+	window.ymin = std::min(ly0, ly1);
+	window.ymax = std::max(ly0, ly1);
+	return window;
+}
+
+int Clipper::computeOutCode(const ClipWindow& window, double x, double y)
+{
+	int code = ocInside;
+	if (x < window.xmin) code |= ocLeft;
+	else if (x > window.xmax) code |= ocRight;
+	if (y < window.ymin) code |= ocBottom;
+	else if (y > window.ymax) code |= ocTop;
+	return code;
+}
+
+bool Clipper::clipLine(const ClipWindow& window, double x0, double y0, double x1, double y1, double& t0, double& t1)
+{
+	t0 = 0;
+	t1 = 1;
+
+	int code0 = computeOutCode(window, x0, y0);
+	int code1 = computeOutCode(window, x1, y1);
+	if ((code0 | code1) == ocInside) return true;//两端都在窗口内
+	if (code0 & code1) return false;//两端在窗口同一条边的外侧
+
+	// Liang–Barsky：对每条边，p·t <= q 给出t的一个上界（p > 0）或下界（p < 0）
+	double dx = x1 - x0;
+	double dy = y1 - y0;
+	double p[4] = { -dx, dx, -dy, dy };
+	double q[4] = { x0 - window.xmin, window.xmax - x0, y0 - window.ymin, window.ymax - y0 };
+	for (int i = 0; i < 4; ++i)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0) return false;//与该边平行且在外侧
+			continue;
+		}
+
+		double t = q[i] / p[i];
+		if (p[i] < 0)
+		{
+			if (t > t1) return false;
+			if (t > t0) t0 = t;
+		}
+		else
+		{
+			if (t < t0) return false;
+			if (t < t1) t1 = t;
+		}
+	}
+	return true;
+}
+
+/// 用一条边裁剪多边形，inside(x, y)判断点是否在边的内侧，intersect(a, b)求ab与边的交点
+template<class Point, class Inside, class Intersect>
+static void clipPolygonEdge(const std::vector<Point>& in, std::vector<Point>& out, Inside inside, Intersect intersect)
+{
+	out.clear();
+	size_t count = in.size();
+	if (count == 0) return;
+
+	Point prev = in[count - 1];
+	bool prevInside = inside(prev);
+	for (size_t i = 0; i < count; ++i)
+	{
+		Point cur = in[i];
+		bool curInside = inside(cur);
+		if (curInside != prevInside) out.push_back(intersect(prev, cur));
+		if (curInside) out.push_back(cur);
+		prev = cur;
+		prevInside = curInside;
+	}
+}
+
+/// a、b之间横坐标为x的点，纵坐标四舍五入
+static PixelPoint intersectVertical(const PixelPoint& a, const PixelPoint& b, int x)
+{
+	PixelPoint pt;
+	pt.x = x;
+	pt.y = (int)floor(a.y + (double)(b.y - a.y) * (x - a.x) / (b.x - a.x) + 0.5);
+	return pt;
+}
+
+/// a、b之间纵坐标为y的点，横坐标四舍五入
+static PixelPoint intersectHorizontal(const PixelPoint& a, const PixelPoint& b, int y)
+{
+	PixelPoint pt;
+	pt.x = (int)floor(a.x + (double)(b.x - a.x) * (y - a.y) / (b.y - a.y) + 0.5);
+	pt.y = y;
+	return pt;
+}
+
+int Clipper::clipPolygon(const ClipWindow& window, const PixelPoint* pts, int count, std::vector<PixelPoint>& out)
+{
+	// 多线程绘制时每个线程使用各自的临时数组
+	thread_local std::vector<PixelPoint> temp;
+
+	out.assign(pts, pts + count);
+	clipPolygonEdge(out, temp,
+		[&](const PixelPoint& p) { return p.x >= window.xmin; },
+		[&](const PixelPoint& a, const PixelPoint& b) { return intersectVertical(a, b, window.xmin); });
+	clipPolygonEdge(temp, out,
+		[&](const PixelPoint& p) { return p.x <= window.xmax; },
+		[&](const PixelPoint& a, const PixelPoint& b) { return intersectVertical(a, b, window.xmax); });
+	clipPolygonEdge(out, temp,
+		[&](const PixelPoint& p) { return p.y >= window.ymin; },
+		[&](const PixelPoint& a, const PixelPoint& b) { return intersectHorizontal(a, b, window.ymin); });
+	clipPolygonEdge(temp, out,
+		[&](const PixelPoint& p) { return p.y <= window.ymax; },
+		[&](const PixelPoint& a, const PixelPoint& b) { return intersectHorizontal(a, b, window.ymax); });
+
+	return (int)out.size();
+}
+
+int Clipper::clipPolygon(const ClipWindow& window, const LogicalPoint* pts, int count, std::vector<LogicalPoint>& out)
+{
+	thread_local std::vector<LogicalPoint> temp;
+
+	// 交点保留小数，只在最后取整一次
+	auto intersectX = [](const LogicalPoint& a, const LogicalPoint& b, double x) {
+		LogicalPoint pt = { x, a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x) };
+		return pt;
+	};
+	auto intersectY = [](const LogicalPoint& a, const LogicalPoint& b, double y) {
+		LogicalPoint pt = { a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y), y };
+		return pt;
+	};
+
+	out.assign(pts, pts + count);
+	clipPolygonEdge(out, temp,
+		[&](const LogicalPoint& p) { return p.x >= window.xmin; },
+		[&](const LogicalPoint& a, const LogicalPoint& b) { return intersectX(a, b, window.xmin); });
+	clipPolygonEdge(temp, out,
+		[&](const LogicalPoint& p) { return p.x <= window.xmax; },
+		[&](const LogicalPoint& a, const LogicalPoint& b) { return intersectX(a, b, window.xmax); });
+	clipPolygonEdge(out, temp,
+		[&](const LogicalPoint& p) { return p.y >= window.ymin; },
+		[&](const LogicalPoint& a, const LogicalPoint& b) { return intersectY(a, b, window.ymin); });
+	clipPolygonEdge(temp, out,
+		[&](const LogicalPoint& p) { return p.y <= window.ymax; },
+		[&](const LogicalPoint& a, const LogicalPoint& b) { return intersectY(a, b, window.ymax); });
+
+	return (int)out.size();
+}
+
+int Clipper::flattenEllipse(const ClipWindow& window, double cx, double cy, double rx, double ry, double tolerance, std::vector<LogicalPoint>& out)
+{
+	out.clear();
+	if (cx + rx < window.xmin || cx - rx > window.xmax || cy + ry < window.ymin || cy - ry > window.ymax) return 0;
+
+	// 参数方程P(t) = (cx + rx·cos t, cy + ry·sin t)，|P''(t)|不超过r = max(rx, ry)：
+	// 参数步长为dt的弦与弧的距离不超过r·dt²/8，弧长不超过r·dt
+	const double TWO_PI = 6.283185307179586;
+	const size_t MAX_POINTS = 1 << 20;
+	double r = std::max(rx, ry);
+	double fineStep = sqrt(8 * tolerance / r);
+	for (double t = 0; t < TWO_PI && out.size() < MAX_POINTS; )
+	{
+		LogicalPoint pt = { cx + rx * cos(t), cy + ry * sin(t) };
+		out.push_back(pt);
+
+		// 到窗口的距离的下界；弧长不超过其一半时，弧和弦上的点都在窗口外
+		double distance = std::max(std::max(window.xmin - pt.x, pt.x - window.xmax), std::max(window.ymin - pt.y, pt.y - window.ymax));
+		t += std::max(fineStep, distance * 0.5 / r);
+	}
+	return (int)out.size();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Graphic.h"
+#include <vector>
+
+/// 裁剪窗口，逻辑坐标矩形[xmin, xmax] × [ymin, ymax]（包含端点）
+struct ClipWindow
+{
+	int xmin, ymin, xmax, ymax;
+
+	/// 不限制范围的窗口，坐标留有余量，扩展后不会溢出
+	static ClipWindow unbounded()
+	{
+		ClipWindow window = { -0x3FFFFFFF, -0x3FFFFFFF, 0x3FFFFFFF, 0x3FFFFFFF };
+		return window;
+	}
+
+	bool contains(int x, int y) const
+	{
+		return x >= xmin && x <= xmax && y >= ymin && y <= ymax;
+	}
+
+	/// 矩形[x0, x1] × [y0, y1]是否与窗口相交
+	bool intersects(int x0, int y0, int x1, int y1) const
+	{
+		return x0 <= xmax && x1 >= xmin && y0 <= ymax && y1 >= ymin;
+	}
+
+	/// 矩形[x0, x1] × [y0, y1]是否完全在窗口内
+	bool encloses(int x0, int y0, int x1, int y1) const
+	{
+		return x0 >= xmin && x1 <= xmax && y0 >= ymin && y1 <= ymax;
+	}
+
+	/// 四边各向外扩展margin，结果限制在unbounded()之内
+	ClipWindow inflated(int margin) const;
+};
+
+/// 双精度的逻辑坐标点，视图变换之后、取整为像素之前使用
+struct LogicalPoint
+{
+	double x, y;
+};
+
+/// 裁剪工具：光栅化之前把图元裁剪到可见窗口内，窗口外的部分不再逐像素计算
+class Clipper
+{
+public:
+	/// Cohen–Sutherland区域码的各位
+	enum OutCode { ocInside = 0, ocLeft = 1, ocRight = 2, ocBottom = 4, ocTop = 8 };
+
+	/// 当前线程的可见区域（裁剪矩形，未设置时为整个绘制目标）对应的逻辑坐标窗口
+	/// @return 没有可见区域（窗口尚未创建）时返回false
+	static bool getViewportWindow(ClipWindow& window);
+
+	/// 设备坐标矩形(x, y, width, height)按当前的原点和y轴方向对应的逻辑坐标窗口，width、height大于0
+	static ClipWindow getDeviceWindow(int x, int y, int width, int height);
+
+	/// 点相对窗口的Cohen–Sutherland区域码
+	static int computeOutCode(const ClipWindow& window, double x, double y);
+
+	/// 求线段(x0, y0)-(x1, y1)位于窗口内的参数范围[t0, t1]（0 <= t0 <= t1 <= 1），线段上的点为P0 + t·(P1 - P0)
+	/// 先用Cohen–Sutherland区域码判断完全在窗口内外的情况，其余用Liang–Barsky算法求交
+	/// @return 线段与窗口不相交时返回false
+	static bool clipLine(const ClipWindow& window, double x0, double y0, double x1, double y1, double& t0, double& t1);
+
+	/// Sutherland–Hodgman算法，依次用窗口的四条边裁剪多边形，结果写入out
+	/// 交点取整到最近的整数坐标，裁剪后的边与原来的边相差不超过半个像素
+	/// @return 裁剪后的顶点数，小于3时多边形与窗口不相交
+	static int clipPolygon(const ClipWindow& window, const PixelPoint* pts, int count, std::vector<PixelPoint>& out);
+
+	/// 同上，坐标为双精度，交点不取整；用于视图变换后先把多边形裁剪到保护带内，取整时顶点不会越界，边的方向不变
+	static int clipPolygon(const ClipWindow& window, const LogicalPoint* pts, int count, std::vector<LogicalPoint>& out);
+
+	/// 把圆心为(cx, cy)、半径为rx、ry的椭圆折线化为多边形，写入out，用于半径大到无法按整数光栅化的圆和椭圆，结果再裁剪到窗口内
+	/// 窗口内的弦与弧的距离不超过tolerance；窗口外的点离窗口越远折线越稀疏，步长不超过到窗口距离的一半，弦不会进入窗口
+	/// @return 顶点数，椭圆的边界框与窗口不相交时为0
+	static int flattenEllipse(const ClipWindow& window, double cx, double cy, double rx, double ry, double tolerance, std::vector<LogicalPoint>& out);
+};
@@ -0,0 +1,347 @@
+#include "CoverageRasterizer.h"
+#include "PixelSink.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+///椭圆折线化时弦与弧之间的最大距离（像素），小于覆盖率能分辨的精度
+const double ELLIPSE_FLATNESS = 0.125;
+
+void CoverageRasterizer::fillPolygon(const PixelPoint* pts, int count, Color color)
+{
+	int ringOffsets[2] = { 0, count };
+	fillPolyPolygon(pts, ringOffsets, 1, frEvenOdd, color);
+}
+
+void CoverageRasterizer::fillPolyPolygon(const PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color color)
+{
+	if (pts == nullptr || ringCount <= 0) return;
+	int first = ringOffsets[0], count = ringOffsets[ringCount] - first;
+	if (count < 3) return;
+
+	int origX, origY;
+	getOrig(origX, origY);
+	int upY = isYUp() ? -1 : 1;
+
+	path.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		path[i].x = pts[first + i].x + origX + 0.5;
+		path[i].y = origY + upY * pts[first + i].y + 0.5;
+	}
+	pathRings.resize(ringCount + 1);
+	for (int r = 0; r <= ringCount; ++r)
+	{
+		pathRings[r] = ringOffsets[r] - first;
+	}
+	fillPath(rule, color);
+}
+
+void CoverageRasterizer::fillEllipse(int centerX, int centerY, int radiusX, int radiusY, Color color)
+{
+	if (radiusX <= 0 || radiusY <= 0) return;
+
+	int origX, origY;
+	getOrig(origX, origY);
+	int upY = isYUp() ? -1 : 1;
+
+	// 不反走样填充包含中心距离为半径的像素，其外侧边缘在半径之外半个像素
+	double rx = radiusX + 0.5;
+	double ry = radiusY + 0.5;
+	double cx = centerX + origX + 0.5;
+	double cy = origY + upY * centerY + 0.5;
+
+	// 半径r的圆弧每段圆心角为2·acos(1 - flatness / r)时弦高为flatness
+	const double PI = 3.14159265358979323846;
+	double r = std::max(rx, ry);
+	int segments = (int)ceil(PI / acos(1 - std::min(1.0, ELLIPSE_FLATNESS / r)));
+	segments = std::max(segments, 8);
+
+	// 单位圆上的点每次旋转一段圆心角，只需求一次三角函数；几十段内累积的舍入误差远小于覆盖率的精度
+	double stepCos = cos(2 * PI / segments), stepSin = sin(2 * PI / segments);
+	double ux = 1, uy = 0;
+	path.resize(segments);
+	for (int i = 0; i < segments; ++i)
+	{
+		path[i].x = cx + rx * ux;
+		path[i].y = cy + ry * uy;
+		double nx = ux * stepCos - uy * stepSin;
+		uy = ux * stepSin + uy * stepCos;
+		ux = nx;
+	}
+	pathRings.assign(1, 0);
+	pathRings.push_back(segments);
+	fillPath(frNonZero, color);
+}
+
+void CoverageRasterizer::fillPath(FillRule rule, Color color)
+{
+	FrameBufferSink sink;
+
+	// 缓冲区取图形的包围盒与可写区域（绘制目标和裁剪矩形）的交集
+	double xmin = path[0].x, xmax = path[0].x, ymin = path[0].y, ymax = path[0].y;
+	for (size_t i = 1; i < path.size(); ++i)
+	{
+		xmin = std::min(xmin, path[i].x);
+		xmax = std::max(xmax, path[i].x);
+		ymin = std::min(ymin, path[i].y);
+		ymax = std::max(ymax, path[i].y);
+	}
+
+	int width = sink.pBits ? sink.width : getWindowWidth();
+	int height = sink.pBits ? sink.height : getWindowHeight();
+	int clipX0 = 0, clipX1 = width, clipY0 = 0, clipY1 = height;
+	if (sink.clipping)
+	{
+		clipX0 = std::max(clipX0, sink.clipX);
+		clipX1 = std::min(clipX1, sink.clipX + sink.clipWidth);
+		clipY0 = std::max(clipY0, sink.clipY);
+		clipY1 = std::min(clipY1, sink.clipY + sink.clipHeight);
+	}
+
+	bx0 = (int)std::max<double>(floor(xmin), clipX0);
+	bx1 = (int)std::min<double>(ceil(xmax), clipX1);
+	by0 = (int)std::max<double>(floor(ymin), clipY0);
+	by1 = (int)std::min<double>(ceil(ymax), clipY1);
+	if (bx0 >= bx1 || by0 >= by1) return;
+
+	stride = bx1 - bx0 + 2;
+	size_t size = (size_t)stride * (by1 - by0);
+	if (cells.size() < size) cells.resize(size, 0.0f);
+	if (alphaRow.size() < (size_t)stride) alphaRow.resize(stride);
+
+	for (size_t r = 0; r + 1 < pathRings.size(); ++r)
+	{
+		int first = pathRings[r], last = pathRings[r + 1] - 1;
+		for (int i = first; i <= last; ++i)
+		{
+			accumulateEdge(path[i], path[i < last ? i + 1 : first]);
+		}
+	}
+
+	for (int y = by0; y < by1; ++y)
+	{
+		resolveRow(&cells[(size_t)(y - by0) * stride], y, rule, sink, color);
+	}
+}
+
+void CoverageRasterizer::accumulateEdge(DevicePoint p0, DevicePoint p1)
+{
+	if (p0.y == p1.y) return;
+
+	// 按x = bx0、x = bx1把边分成至多三段，缓冲区外的段压成边界上的竖线：
+	// 左侧的段对其右边所有像素的覆盖率贡献与边界上的竖线相同，右侧的段不影响缓冲区内的像素
+	double bounds[2] = { (double)bx0, (double)bx1 };
+	DevicePoint pieces[4];
+	int pieceCount = 0;
+	pieces[pieceCount++] = p0;
+
+	double tSplit[2];
+	int splitCount = 0;
+	for (int k = 0; k < 2; ++k)
+	{
+		double b = bounds[k];
+		if ((p0.x < b && p1.x > b) || (p0.x > b && p1.x < b)) tSplit[splitCount++] = (b - p0.x) / (p1.x - p0.x);
+	}
+	if (splitCount == 2 && tSplit[0] > tSplit[1]) std::swap(tSplit[0], tSplit[1]);
+	for (int k = 0; k < splitCount; ++k)
+	{
+		DevicePoint pt;
+		pt.x = p0.x + (p1.x - p0.x) * tSplit[k];
+		pt.y = p0.y + (p1.y - p0.y) * tSplit[k];
+		pieces[pieceCount++] = pt;
+	}
+	pieces[pieceCount++] = p1;
+
+	for (int k = 0; k + 1 < pieceCount; ++k)
+	{
+		DevicePoint a = pieces[k], b = pieces[k + 1];
+		a.x = std::min(std::max(a.x, bounds[0]), bounds[1]);
+		b.x = std::min(std::max(b.x, bounds[0]), bounds[1]);
+		accumulateClampedEdge(a, b);
+	}
+}
+
+void CoverageRasterizer::accumulateClampedEdge(const DevicePoint& p0In, const DevicePoint& p1In)
+{
+	if (p0In.y == p1In.y) return;
+
+	// 统一成从上到下，dir记录原来的方向
+	double dir = p0In.y < p1In.y ? 1.0 : -1.0;
+	const DevicePoint& p0 = dir > 0 ? p0In : p1In;
+	const DevicePoint& p1 = dir > 0 ? p1In : p0In;
+	double dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+
+	// 只处理缓冲区内的行；每行的交点直接由端点求出，不逐行累加，与缓冲区的范围无关
+	int yFirst = std::max(by0, (int)floor(p0.y));
+	int yLast = std::min(by1, (int)ceil(p1.y));
+	for (int y = yFirst; y < yLast; ++y)
+	{
+		double ya = std::max((double)y, p0.y);
+		double yb = std::min((double)(y + 1), p1.y);
+		if (ya >= yb) continue;
+
+		// 端点已在[bx0, bx1]内，插值的舍入误差仍可能使交点略微越界，需要再限制一次
+		double xa = std::min(std::max(p0.x + (ya - p0.y) * dxdy, (double)bx0), (double)bx1);
+		double xb = std::min(std::max(p0.x + (yb - p0.y) * dxdy, (double)bx0), (double)bx1);
+		double d = (yb - ya) * dir;
+		float* row = &cells[(size_t)(y - by0) * stride];
+
+		// x0i、x1i为相对缓冲区左边界的列号；交点不小于bx0 >= 0，取整即为向下取整，不必调用floor、ceil
+		double x0 = std::min(xa, xb), x1 = std::max(xa, xb);
+		int x0int = (int)x0, x1int = (int)x1;
+		double x0floor = x0int;
+		int x0i = x0int - bx0;
+		double x1ceil = x1int + (x1 > x1int ? 1 : 0);
+		int x1i = (int)x1ceil - bx0;
+
+		if (x1i <= x0i + 1)
+		{
+			// 这一行的边在一个像素内，按边的平均x分到该像素和右边的像素
+			double xmf = 0.5 * (xa + xb) - x0floor;
+			row[x0i] += (float)(d - d * xmf);
+			row[x0i + 1] += (float)(d * xmf);
+			continue;
+		}
+
+		// 边跨越多个像素：两端的像素为三角形面积，中间的像素按梯形面积线性递增
+		double s = 1.0 / (x1 - x0);
+		double x0f = x0 - x0floor;
+		double a0 = 0.5 * s * (1 - x0f) * (1 - x0f);
+		double x1f = x1 - x1ceil + 1;
+		double am = 0.5 * s * x1f * x1f;
+		row[x0i] += (float)(d * a0);
+		if (x1i == x0i + 2)
+		{
+			row[x0i + 1] += (float)(d * (1 - a0 - am));
+		}
+		else
+		{
+			double a1 = s * (1.5 - x0f);
+			row[x0i + 1] += (float)(d * (a1 - a0));
+			for (int xi = x0i + 2; xi < x1i - 1; ++xi)
+			{
+				row[xi] += (float)(d * s);
+			}
+			double a2 = a1 + (x1i - x0i - 3) * s;
+			row[x1i - 1] += (float)(d * (1 - a2 - am));
+		}
+		row[x1i] += (float)(d * am);
+	}
+}
+
+/// 累加值（带覆盖率的环绕数）对应的覆盖率（0～255）
+/// 非零规则下环绕数的绝对值超过1的部分都算完全覆盖，奇偶规则下环绕数每增加2回到未覆盖
+static inline unsigned coverageToAlpha(float acc, FillRule rule)
+{
+	float coverage = fabsf(acc);
+	if (rule == frEvenOdd)
+	{
+		coverage -= 2.0f * floorf(coverage * 0.5f);
+		if (coverage > 1.0f) coverage = 2.0f - coverage;
+	}
+	return (unsigned)(std::min(coverage, 1.0f) * 255.0f + 0.5f);
+}
+
+/// row中从i开始第一个不为0的单元，没有时返回count
+static int findNonZeroCell(const float* row, int i, int count)
+{
+#ifdef DYNAMICMATRIX_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	// 图形内部的单元大多为0，每次检查16个
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128 any = _mm_or_ps(_mm_or_ps(_mm_loadu_ps(row + i), _mm_loadu_ps(row + i + 4)),
+			_mm_or_ps(_mm_loadu_ps(row + i + 8), _mm_loadu_ps(row + i + 12)));
+		if (_mm_movemask_ps(_mm_cmpneq_ps(any, zero))) break;
+	}
+	for (; i + 4 <= count; i += 4)
+	{
+		if (_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(row + i), zero))) break;
+	}
+#endif
+	while (i < count && row[i] == 0) ++i;
+	return i;
+}
+
+#ifdef DYNAMICMATRIX_SSE2
+/// 4个单元的前缀和：分量依次移位4、8字节累加，再加上之前所有单元的和carry（4个分量相同），carry更新为最后一个分量
+static inline __m128 prefixSum4(__m128 v, __m128& carry)
+{
+	v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+	v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+	v = _mm_add_ps(v, carry);
+	carry = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+	return v;
+}
+
+/// coverageToAlpha的4路版本，结果写到alpha[0..3]
+static inline void coverageToAlpha4(__m128 acc, FillRule rule, unsigned char* alpha)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 coverage = _mm_andnot_ps(_mm_set1_ps(-0.0f), acc);
+	if (rule == frEvenOdd)
+	{
+		// 覆盖率非负，截断即为floor；超过1的部分2 - coverage小于coverage
+		__m128 half = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(coverage, _mm_set1_ps(0.5f))));
+		coverage = _mm_sub_ps(coverage, _mm_add_ps(half, half));
+		coverage = _mm_min_ps(coverage, _mm_sub_ps(_mm_set1_ps(2.0f), coverage));
+	}
+	coverage = _mm_min_ps(coverage, one);
+	__m128i value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+	value = _mm_packs_epi32(value, value);
+	int packed = _mm_cvtsi128_si32(_mm_packus_epi16(value, value));
+	memcpy(alpha, &packed, 4);
+}
+#endif
+
+void CoverageRasterizer::resolveRow(float* row, int dy, FillRule rule, FrameBufferSink& sink, Color color)
+{
+	int count = bx1 - bx0;
+	float acc = 0;
+	int i = 0;
+	while (i < count)
+	{
+		// 为0的单元前缀和不变，整段覆盖率相同（图形内部或外部）
+		int next = findNonZeroCell(row, i, count);
+		if (next > i) sink.blendDeviceRun(dy, bx0 + i, next - i, coverageToAlpha(acc, rule), color);
+		i = next;
+
+		// 边经过的单元求前缀和得到覆盖率，同时把累加值清零；每次4个单元，直到连续ZERO_RUN个单元为0，块中为0的单元覆盖率不变，一起写入
+		// 较短的0段（小图形的内部）留在这里一起混合，比分成多段整段填充的开销小
+		int start = i;
+#ifdef DYNAMICMATRIX_SSE2
+		const int ZERO_RUN = 16;
+		const __m128 zero = _mm_setzero_ps();
+		__m128 carry = _mm_set1_ps(acc);
+		int zeroStart = i;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 cell = _mm_loadu_ps(row + i);
+			if (_mm_movemask_ps(_mm_cmpneq_ps(cell, zero)))
+			{
+				zeroStart = i + 4;
+				_mm_storeu_ps(row + i, zero);
+			}
+			else if (i + 4 - zeroStart >= ZERO_RUN)
+			{
+				i = zeroStart;
+				break;
+			}
+			coverageToAlpha4(prefixSum4(cell, carry), rule, &alphaRow[i - start]);
+		}
+		acc = _mm_cvtss_f32(carry);
+#endif
+		for (; i < count && row[i] != 0; ++i)
+		{
+			acc += row[i];
+			row[i] = 0;
+			alphaRow[i - start] = (unsigned char)coverageToAlpha(acc, rule);
+		}
+		if (i > start) sink.blendDeviceSpan(dy, bx0 + start, alphaRow.data(), i - start, color);
+	}
+
+	// 右边界外的两个单元只存放压到边界上的增量，不显示
+	row[count] = 0;
+	row[count + 1] = 0;
+}
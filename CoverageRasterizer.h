@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Graphic.h"
+#include <vector>
+
+struct FrameBufferSink;
+
+/// 反走样填充工具：按每个像素被图形覆盖的面积比例（覆盖率）把颜色混合到帧缓冲区
+/// 每条边把带符号的面积增量累加到所覆盖的单元格中，再逐行求前缀和得到覆盖率；图形内部整段填充，只有边经过的像素逐个混合
+/// 累加值即为带覆盖率的环绕数，按填充规则转换为覆盖率；每个像素的覆盖率只与图形有关，分块绘制时结果与整体绘制相同
+class CoverageRasterizer
+{
+public:
+	/// 填充多边形，pts为逻辑坐标，顶点位于像素中心
+	void fillPolygon(const PixelPoint* pts, int count, Color color);
+
+	/// 填充多个环组成的多边形，第i个环为pts[ringOffsets[i]]到pts[ringOffsets[i + 1] - 1]，环之间重叠的区域按填充规则合并
+	void fillPolyPolygon(const PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color color);
+
+	/// 填充椭圆，半径取到像素的外侧边缘，与不反走样填充的范围一致；圆为两个半径相同的椭圆
+	void fillEllipse(int centerX, int centerY, int radiusX, int radiusY, Color color);
+
+private:
+	/// 设备坐标的点，以像素的左上角为原点，像素(x, y)覆盖[x, x + 1) × [y, y + 1)
+	struct DevicePoint
+	{
+		double x, y;
+	};
+
+	/// 把path中的各个闭合环累加到覆盖率缓冲区，按填充规则rule混合到帧缓冲区
+	void fillPath(FillRule rule, Color color);
+
+	/// 累加一条边，边在x方向超出缓冲区的部分压到缓冲区的左右边界上
+	void accumulateEdge(DevicePoint p0, DevicePoint p1);
+
+	/// 累加完全在[bx0, bx1]列内的一条边
+	void accumulateClampedEdge(const DevicePoint& p0, const DevicePoint& p1);
+
+	/// 逐行求前缀和得到覆盖率并混合到设备坐标dy行，同时把该行的累加值清零
+	/// 连续为0的单元覆盖率不变，整段混合，只有边经过的单元逐个计算
+	void resolveRow(float* row, int dy, FillRule rule, FrameBufferSink& sink, Color color);
+
+	std::vector<DevicePoint> path;// 当前图形的轮廓（设备坐标），每个环首尾相连
+	std::vector<int> pathRings;// 各环在path中的起始下标，最后一项为点数
+	std::vector<float> cells;// 覆盖率缓冲区，每行stride个单元，不使用时全部为0
+	std::vector<unsigned char> alphaRow;
+
+	int bx0, by0, bx1, by1;// 缓冲区覆盖的设备像素范围[bx0, bx1) × [by0, by1)
+	int stride;// 每行的单元数，比像素数多2，存放落在右边界上的增量
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+/// 帧缓冲区已修改区域，用包含所有被修改像素的设备坐标矩形表示（包含端点）
+struct DirtyRect
+{
+	DirtyRect() { reset(); }
+
+	/// 清空已修改区域
+	void reset()
+	{
+		x0 = y0 = 0x7FFFFFFF;
+		x1 = y1 = -0x7FFFFFFF - 1;
+	}
+
+	bool isEmpty() const { return x0 > x1 || y0 > y1; }
+
+	/// 扩展区域使其包含像素(x, y)
+	void expand(int x, int y)
+	{
+		if (x < x0) x0 = x;
+		if (x > x1) x1 = x;
+		if (y < y0) y0 = y;
+		if (y > y1) y1 = y;
+	}
+
+	/// 扩展区域使其包含矩形[xmin, xmax] × [ymin, ymax]
+	void expand(int xmin, int ymin, int xmax, int ymax)
+	{
+		if (xmin > xmax || ymin > ymax) return;
+		if (xmin < x0) x0 = xmin;
+		if (xmax > x1) x1 = xmax;
+		if (ymin < y0) y0 = ymin;
+		if (ymax > y1) y1 = ymax;
+	}
+
+	/// 裁剪到[0, width) × [0, height)
+	void clip(int width, int height)
+	{
+		if (x0 < 0) x0 = 0;
+		if (y0 < 0) y0 = 0;
+		if (x1 >= width) x1 = width - 1;
+		if (y1 >= height) y1 = height - 1;
+	}
+
+	int x0, y0;
+	int x1, y1;
+};
@@ -0,0 +1,339 @@
+#include "DisplayList.h"
+#include "Painter.h"
+#include "Renderer.h"
+#include "Rasterizer.h"
+#include <algorithm>
+
+DisplayList::DisplayList()
+{
+	currentItem = -1;
+	unrecordedCount = 0;
+	pRecordedLayer = NULL;
+	recordedVersion = 0;
+	recordedViewVersion = 0;
+}
+
+void DisplayList::clear()
+{
+	commands.clear();
+	items.clear();
+	unrecordedCount = 0;
+	pRecordedLayer = NULL;
+}
+
+void DisplayList::reset(Layer* pLayer)
+{
+	clear();
+
+	Item item;
+	item.begin = item.end = 0;
+	item.xmin = item.ymin = 0x7FFFFFFF;
+	item.xmax = item.ymax = -0x7FFFFFFF - 1;
+	item.recorded = false;
+	items.assign(pLayer->getColumns().size(), item);
+	unrecordedCount = (int)items.size();
+
+	pRecordedLayer = pLayer;
+	recordedVersion = pLayer->version;
+	recordedViewVersion = g_viewTransform.getVersion();
+}
+
+void DisplayList::record(Layer* pLayer)
+{
+	reset(pLayer);
+	recordAll();
+}
+
+void DisplayList::recordItems(const std::vector<int>& indices)
+{
+	if (unrecordedCount == 0) return;
+
+	// 按列式存储读取各对象，不访问各个几何对象
+	const GeometryColumns& columns = pRecordedLayer->getColumns();
+	for (size_t k = 0, size = indices.size(); k < size; ++k)
+	{
+		if (!items[indices[k]].recorded) recordItem(columns, indices[k]);
+	}
+}
+
+void DisplayList::recordAll()
+{
+	if (unrecordedCount == 0) return;
+
+	const GeometryColumns& columns = pRecordedLayer->getColumns();
+	for (int i = 0, size = (int)items.size(); i < size; ++i)
+	{
+		if (!items[i].recorded) recordItem(columns, i);
+	}
+}
+
+void DisplayList::recordItem(const GeometryColumns& columns, int i)
+{
+	currentItem = i;
+	items[i].begin = commands.size();
+	emitGeometry(columns.get(i), *this);
+	items[i].end = commands.size();
+	items[i].recorded = true;
+	--unrecordedCount;
+}
+
+bool DisplayList::isRecordedFrom(Layer* pLayer) const
+{
+	return pRecordedLayer == pLayer && recordedVersion == pLayer->version && recordedViewVersion == g_viewTransform.getVersion();
+}
+
+bool DisplayList::getItemBounds(int i, int& xmin, int& ymin, int& xmax, int& ymax) const
+{
+	const Item& item = items[i];
+	if (item.begin == item.end) return false;
+
+	xmin = item.xmin;
+	ymin = item.ymin;
+	xmax = item.xmax;
+	ymax = item.ymax;
+	return true;
+}
+
+void DisplayList::replay(Painter& painter)
+{
+	// 按需记录的项在缓冲区中不一定按序号排列，命令首尾相接的一段作为一个范围回放
+	for (size_t i = 0, size = items.size(); i < size;)
+	{
+		size_t begin = items[i].begin, end = items[i].end;
+		for (++i; i < size && items[i].begin == end; ++i) end = items[i].end;
+		replayCommands(begin, end, painter);
+	}
+}
+
+void DisplayList::replayItem(int i, Painter& painter)
+{
+	replayCommands(items[i].begin, items[i].end, painter);
+}
+
+void DisplayList::replayItems(const std::vector<int>& indices, Painter& painter)
+{
+	// 序号连续、命令在缓冲区中首尾相接的一段可以作为一个范围回放，线段仍能合并绘制
+	for (size_t i = 0, size = indices.size(); i < size;)
+	{
+		int last = indices[i];
+		size_t begin = items[last].begin, end = items[last].end;
+		for (++i; i < size && indices[i] == last + 1 && items[indices[i]].begin == end; ++i)
+		{
+			last = indices[i];
+			end = items[last].end;
+		}
+		replayCommands(begin, end, painter);
+	}
+}
+
+PixelPoint* DisplayList::addCommand(CommandType type, int pointCount)
+{
+	PixelPoint header = { type, pointCount };
+	commands.push_back(header);
+	size_t first = commands.size();
+	commands.resize(first + pointCount);
+	return &commands[first];
+}
+
+void DisplayList::expandItem(int xmin, int ymin, int xmax, int ymax)
+{
+	Item& item = items[currentItem];
+	item.xmin = std::min(item.xmin, xmin);
+	item.ymin = std::min(item.ymin, ymin);
+	item.xmax = std::max(item.xmax, xmax);
+	item.ymax = std::max(item.ymax, ymax);
+}
+
+void DisplayList::drawLine(int x0, int y0, int x1, int y1)
+{
+	PixelPoint* pts = addCommand(dcDrawLine, 2);
+	pts[0].x = x0, pts[0].y = y0;
+	pts[1].x = x1, pts[1].y = y1;
+	expandItem(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+}
+
+void DisplayList::drawLines(const PixelPoint* pairs, int n)
+{
+	if (pairs == NULL || n <= 0) return;
+
+	PixelPoint* dst = addCommand(dcDrawLines, 2 * n);
+	for (int i = 0; i < 2 * n; ++i)
+	{
+		dst[i] = pairs[i];
+		expandItem(pairs[i].x, pairs[i].y, pairs[i].x, pairs[i].y);
+	}
+}
+
+void DisplayList::drawLineDDA(double x0, double y0, double x1, double y1)
+{
+	PixelPoint* pts = addCommand(dcDrawLineDDA, 2);
+	pts[0].x = toSubpixel(x0), pts[0].y = toSubpixel(y0);
+	pts[1].x = toSubpixel(x1), pts[1].y = toSubpixel(y1);
+	expandItem((int)floor(std::min(x0, x1)), (int)floor(std::min(y0, y1)), (int)ceil(std::max(x0, x1)), (int)ceil(std::max(y0, y1)));
+}
+
+void DisplayList::drawPolygon(PixelPoint* pts, int count)
+{
+	if (pts == NULL || count <= 0) return;
+
+	PixelPoint* dst = addCommand(dcDrawPolygon, count);
+	for (int i = 0; i < count; ++i)
+	{
+		dst[i] = pts[i];
+		expandItem(pts[i].x, pts[i].y, pts[i].x, pts[i].y);
+	}
+}
+
+void DisplayList::drawRectangle(int x1, int y1, int x2, int y2)
+{
+	PixelPoint* pts = addCommand(dcDrawRectangle, 2);
+	pts[0].x = x1, pts[0].y = y1;
+	pts[1].x = x2, pts[1].y = y2;
+	expandItem(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2));
+}
+
+void DisplayList::fillPolygon(PixelPoint* pts, int count)
+{
+	if (pts == NULL || count <= 0) return;
+
+	PixelPoint* dst = addCommand(dcFillPolygon, count);
+	for (int i = 0; i < count; ++i)
+	{
+		dst[i] = pts[i];
+		expandItem(pts[i].x, pts[i].y, pts[i].x, pts[i].y);
+	}
+}
+
+void DisplayList::fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule)
+{
+	if (pts == NULL || ringCount <= 0) return;
+
+	int first = ringOffsets[0], count = ringOffsets[ringCount] - first;
+	if (count <= 0) return;
+
+	PixelPoint* dst = addCommand(dcFillPolyPolygon, ringCount + 2 + count);
+	dst[0].x = ringCount, dst[0].y = rule;
+	for (int r = 0; r <= ringCount; ++r)
+	{
+		dst[1 + r].x = ringOffsets[r] - first, dst[1 + r].y = 0;
+	}
+	dst += ringCount + 2;
+	for (int i = 0; i < count; ++i)
+	{
+		dst[i] = pts[first + i];
+		expandItem(dst[i].x, dst[i].y, dst[i].x, dst[i].y);
+	}
+}
+
+void DisplayList::fillRectangle(int x1, int y1, int x2, int y2)
+{
+	PixelPoint* pts = addCommand(dcFillRectangle, 2);
+	pts[0].x = x1, pts[0].y = y1;
+	pts[1].x = x2, pts[1].y = y2;
+	expandItem(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2));
+}
+
+void DisplayList::fillCircle(int centerX, int centerY, int radius)
+{
+	PixelPoint* pts = addCommand(dcFillCircle, 2);
+	pts[0].x = centerX, pts[0].y = centerY;
+	pts[1].x = radius, pts[1].y = radius;
+	expandItem(centerX - radius, centerY - radius, centerX + radius, centerY + radius);
+}
+
+void DisplayList::fillEllipse(int centerX, int centerY, int radiusX, int radiusY)
+{
+	PixelPoint* pts = addCommand(dcFillEllipse, 2);
+	pts[0].x = centerX, pts[0].y = centerY;
+	pts[1].x = radiusX, pts[1].y = radiusY;
+	expandItem(centerX - radiusX, centerY - radiusY, centerX + radiusX, centerY + radiusY);
+}
+
+void DisplayList::drawCircle(int centerX, int centerY, int radius)
+{
+	PixelPoint* pts = addCommand(dcDrawCircle, 2);
+	pts[0].x = centerX, pts[0].y = centerY;
+	pts[1].x = radius, pts[1].y = radius;
+	expandItem(centerX - radius, centerY - radius, centerX + radius, centerY + radius);
+}
+
+void DisplayList::drawEllipse(int centerX, int centerY, int radiusX, int radiusY)
+{
+	PixelPoint* pts = addCommand(dcDrawEllipse, 2);
+	pts[0].x = centerX, pts[0].y = centerY;
+	pts[1].x = radiusX, pts[1].y = radiusY;
+	expandItem(centerX - radiusX, centerY - radiusY, centerX + radiusX, centerY + radiusY);
+}
+
+void DisplayList::replayCommands(size_t begin, size_t end, Painter& painter)
+{
+	// 待绘制的线段端点和多环多边形各环的起始下标，多个线程同时回放时各用各的
+	thread_local std::vector<PixelPoint> linePairs;
+	thread_local std::vector<int> ringOffsets;
+	linePairs.clear();
+
+	size_t i = begin;
+	while (i < end)
+	{
+		int type = commands[i].x;
+		int count = commands[i].y;
+		PixelPoint* pts = &commands[i + 1];
+
+		// 线段先收集起来，遇到其他命令或回放结束时一起绘制，绘制顺序不变
+		if (type == dcDrawLine || type == dcDrawLines)
+		{
+			linePairs.insert(linePairs.end(), pts, pts + count);
+			i += 1 + count;
+			continue;
+		}
+		if (!linePairs.empty())
+		{
+			painter.drawLines(linePairs.data(), (int)linePairs.size() / 2);
+			linePairs.clear();
+		}
+
+		switch (type)
+		{
+		case dcDrawLineDDA:
+			painter.drawLineDDA((double)pts[0].x / SUBPIXEL_ONE, (double)pts[0].y / SUBPIXEL_ONE,
+				(double)pts[1].x / SUBPIXEL_ONE, (double)pts[1].y / SUBPIXEL_ONE);
+			break;
+		case dcDrawPolygon:
+			painter.drawPolygon(pts, count);
+			break;
+		case dcDrawRectangle:
+			painter.drawRectangle(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+			break;
+		case dcFillPolygon:
+			painter.fillPolygon(pts, count);
+			break;
+		case dcFillPolyPolygon:
+		{
+			int ringCount = pts[0].x;
+			ringOffsets.resize(ringCount + 1);
+			for (int r = 0; r <= ringCount; ++r) ringOffsets[r] = pts[1 + r].x;
+			painter.fillPolyPolygon(pts + ringCount + 2, ringOffsets.data(), ringCount, (FillRule)pts[0].y);
+		}
+		break;
+		case dcFillRectangle:
+			painter.fillRectangle(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+			break;
+		case dcFillCircle:
+			painter.fillCircle(pts[0].x, pts[0].y, pts[1].x);
+			break;
+		case dcFillEllipse:
+			painter.fillEllipse(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+			break;
+		case dcDrawCircle:
+			painter.drawCircle(pts[0].x, pts[0].y, pts[1].x);
+			break;
+		case dcDrawEllipse:
+			painter.drawEllipse(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+			break;
+		}
+
+		i += 1 + count;
+	}
+
+	if (!linePairs.empty()) painter.drawLines(linePairs.data(), (int)linePairs.size() / 2);
+}
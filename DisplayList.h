@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Graphic.h"
+#include "GeoDefine.h"
+#include <vector>
+
+class Painter;
+
+/// 显示列表：记录绘制图层时产生的图元调用（图元类型和转换好的整数像素坐标），保存在一块连续的缓冲区中
+/// 重绘时直接回放到Painter，不再遍历几何对象、调用虚函数、转换坐标，只剩光栅化的开销
+/// 记录接口与Painter的绘制接口相同，可作为emitGeometry的目标
+/// 坐标为Painter使用的逻辑坐标，回放时按当时的原点、y轴方向和绘制模式光栅化，这些设置改变后不需要重新记录
+/// 几何对象的世界坐标在记录时按视图变换转换为逻辑坐标，平移、缩放视图后需要重新记录
+/// 每个几何对象对应一项，各项在回放前按需记录（见recordItems），视图改变后只需转换可见的几何对象
+class DisplayList
+{
+public:
+	DisplayList();
+
+	/// 清空记录
+	void clear();
+
+	/// 开始记录图层pLayer当前版本在当前视图变换下的图元：清空原有记录，每个几何对象一项，各项尚未记录
+	void reset(Layer* pLayer);
+
+	/// 重新记录图层中所有几何对象产生的图元，每个几何对象为一项
+	void record(Layer* pLayer);
+
+	/// 记录indices中尚未记录的项（序号从小到大），回放这些项之前调用
+	void recordItems(const std::vector<int>& indices);
+
+	/// 记录所有尚未记录的项，回放所有项之前调用
+	void recordAll();
+
+	/// 是否是图层pLayer当前版本在当前视图变换下的记录
+	bool isRecordedFrom(Layer* pLayer) const;
+
+	/// 记录的项数
+	int getItemCount() const { return (int)items.size(); }
+
+	/// 获取第i项所有图元的逻辑坐标范围（包含端点）
+	/// @return 该项是否有图元
+	bool getItemBounds(int i, int& xmin, int& ymin, int& xmax, int& ymax) const;
+
+	/// 按项的顺序回放所有图元
+	void replay(Painter& painter);
+
+	/// 回放第i项的图元，只读取记录，多个线程可以同时回放
+	void replayItem(int i, Painter& painter);
+
+	/// 按顺序回放indices中的项（序号从小到大），序号连续且命令首尾相接的项一起回放
+	void replayItems(const std::vector<int>& indices, Painter& painter);
+
+	// 记录接口，参数含义与Painter相同
+	void drawLine(int x0, int y0, int x1, int y1);
+	void drawLineDDA(double x0, double y0, double x1, double y1);
+	void drawLines(const PixelPoint* pairs, int n);
+	void drawPolygon(PixelPoint* pts, int count);
+	void drawRectangle(int x1, int y1, int x2, int y2);
+	void fillPolygon(PixelPoint* pts, int count);
+	void fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule);
+	void fillRectangle(int x1, int y1, int x2, int y2);
+	void fillCircle(int centerX, int centerY, int radius);
+	void fillEllipse(int centerX, int centerY, int radiusX, int radiusY);
+	void drawCircle(int centerX, int centerY, int radius);
+	void drawEllipse(int centerX, int centerY, int radiusX, int radiusY);
+
+private:
+	enum CommandType { dcDrawLine, dcDrawLines, dcDrawLineDDA, dcDrawPolygon, dcDrawRectangle, dcFillPolygon, dcFillPolyPolygon, dcFillRectangle, dcFillCircle, dcFillEllipse, dcDrawCircle, dcDrawEllipse };
+
+	/// 一项（一个几何对象）在命令缓冲区中的范围和图元的坐标范围
+	struct Item
+	{
+		size_t begin, end;
+		int xmin, ymin, xmax, ymax;
+		bool recorded;
+	};
+
+	/// 记录第i项，命令追加到缓冲区末尾
+	void recordItem(const GeometryColumns& columns, int i);
+
+	/// 写入命令头并预留pointCount个点，返回第一个点
+	PixelPoint* addCommand(CommandType type, int pointCount);
+
+	/// 扩展当前项的坐标范围
+	void expandItem(int xmin, int ymin, int xmax, int ymax);
+
+	/// 回放命令缓冲区中[begin, end)范围内的命令，连续的线段命令合并为一次批量绘制
+	void replayCommands(size_t begin, size_t end, Painter& painter);
+
+	// 命令缓冲区，每条命令为命令头{类型, 点数}和其后的点，圆和椭圆的半径也按点存放，带小数的端点存为24.8定点数
+	// 多环多边形在点之前存放{环数, 填充规则}和各环的起始下标{下标, 0}（共环数 + 1项，最后一项为点数）
+	// 各项按记录的先后存放，不一定按序号排列
+	std::vector<PixelPoint> commands;
+	std::vector<Item> items;
+	int currentItem;// 正在记录的项
+	int unrecordedCount;// 尚未记录的项数
+
+	Layer* pRecordedLayer;
+	unsigned recordedVersion;
+	unsigned recordedViewVersion;// 记录时视图变换的版本
+};
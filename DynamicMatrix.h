@@ -0,0 +1,344 @@
+/********************************************************************
+file base:	DynamicMatrix
+file ext:	h
+author:		作者(njnu2016@foxmail.com)
+purpose:	动态二维矩阵，用作帧缓冲区、深度缓冲区等
+version:    1.0
+*********************************************************************/
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DYNAMICMATRIX_SSE2
+#endif
+
+///清空区域超过该字节数时使用流式写入（不经过缓存），避免大缓冲区把缓存中的其他数据挤出
+const size_t STREAMING_CLEAR_BYTES = 4 << 20;
+
+/**	用value填充从p开始的count个32位值
+@param  streaming 是否使用流式写入，为true时调用者需在全部写入完成后执行_mm_sfence
+*/
+inline void _fillDWords(unsigned* p, size_t count, unsigned value, bool streaming)
+{
+#ifdef DYNAMICMATRIX_SSE2
+	//先逐个写到16字节对齐
+	while (count > 0 && ((size_t)p & 15))
+	{
+		*p++ = value;
+		--count;
+	}
+
+	__m128i v = _mm_set1_epi32((int)value);
+	size_t blocks = count >> 4;//每次写64字节
+	if (streaming)
+	{
+		for (size_t i = 0; i < blocks; ++i, p += 16)
+		{
+			_mm_stream_si128((__m128i*)p, v);
+			_mm_stream_si128((__m128i*)(p + 4), v);
+			_mm_stream_si128((__m128i*)(p + 8), v);
+			_mm_stream_si128((__m128i*)(p + 12), v);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < blocks; ++i, p += 16)
+		{
+			_mm_store_si128((__m128i*)p, v);
+			_mm_store_si128((__m128i*)(p + 4), v);
+			_mm_store_si128((__m128i*)(p + 8), v);
+			_mm_store_si128((__m128i*)(p + 12), v);
+		}
+	}
+	count &= 15;
+#endif
+
+	while (count--)
+	{
+		*p++ = value;
+	}
+}
+
+/**	把src中的count个32位值复制到dst，等于key的值表示透明，对应的dst保持不变
+*/
+inline void _copyDWordsKeyed(unsigned* dst, const unsigned* src, size_t count, unsigned key)
+{
+#ifdef DYNAMICMATRIX_SSE2
+	__m128i k = _mm_set1_epi32((int)key);
+	for (; count >= 4; count -= 4, src += 4, dst += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)src);
+		__m128i transparent = _mm_cmpeq_epi32(s, k);
+		int mask = _mm_movemask_epi8(transparent);
+		if (mask == 0xFFFF) continue;//4个都透明
+		if (mask != 0)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i*)dst);
+			s = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s));
+		}
+		_mm_storeu_si128((__m128i*)dst, s);
+	}
+#endif
+
+	for (; count > 0; --count, ++src, ++dst)
+	{
+		if (*src != key) *dst = *src;
+	}
+}
+
+/**	按最近邻把一行放大factor倍：dst[i] = src[(i + phase) / factor]，0 <= i < count
+@param  phase 第一个值在dst开头已经被前面截掉的个数，0 <= phase < factor
+*/
+inline void _expandDWords(unsigned* dst, const unsigned* src, size_t count, int factor, int phase)
+{
+	size_t run = (size_t)(factor - phase);
+	while (count > 0)
+	{
+		size_t n = run < count ? run : count;
+		unsigned value = *src++;
+		size_t i = 0;
+#ifdef DYNAMICMATRIX_SSE2
+		__m128i v = _mm_set1_epi32((int)value);
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm_storeu_si128((__m128i*)(dst + i), v);
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			dst[i] = value;
+		}
+		dst += n;
+		count -= n;
+		run = (size_t)factor;
+	}
+}
+
+template< typename T>
+class DynamicMatrix
+{
+public:
+	DynamicMatrix(int alignBytes = 1) { this->alignBytes = alignBytes; pData = 0; width = height = 0; ownsData = true; }
+	~DynamicMatrix(void);
+
+	void freeMatrix();
+	T* operator[](int i);
+	void setSize(int width, int height);
+	///使用外部内存（如DIB位图）作为矩阵数据，每行按alignBytes字节对齐，矩阵不负责释放该内存
+	void attach(T* pBuf, int width, int height, int alignBytes);
+	T* dataPtr()const { return pData ? pData[0] : 0; }
+	template<class U> void clear(const U& value);
+	template<class U> void clear(int x, int y, int size_x, int size_y, const U& value);
+	bool valid()const { return pData || width > 0 || height > 0; }
+	int getLineWidth();
+
+	int alignBytes;
+	int width, height;
+	T** pData;
+	bool ownsData;// 数据内存是否由矩阵分配和释放
+
+private:
+	///将value按字节展开为一个元素：value只有1字节时填满元素的每个字节，否则复制其前sizeof(T)个字节，不足补0
+	template<class U> static void makePattern(const U& value, unsigned char* pattern);
+	///用pattern填充从p开始的count个元素
+	static void fillElements(T* p, size_t count, const unsigned char* pattern, bool streaming);
+};
+
+template< class T>
+DynamicMatrix<T>::~DynamicMatrix(void)
+{
+	freeMatrix();
+}
+
+template< typename T>
+int DynamicMatrix<T>::getLineWidth()
+{
+	return (width * sizeof(T) + alignBytes - 1) / alignBytes * alignBytes;
+}
+
+template< typename T>
+void DynamicMatrix<T>::setSize(int width, int height)
+{
+	if (width == this->width && height == this->height) return;
+
+	if (!ownsData)
+	{
+		freeMatrix();
+		ownsData = true;
+	}
+
+	this->width = width;
+	this->height = height;
+
+	//freeMatrix();	
+
+	int lineWidth = getLineWidth();
+	T* pBuf;
+	if (pData)
+	{
+		pBuf = (T*)realloc(pData[0], lineWidth * height);
+		pData = (T**)realloc(pData, sizeof(T*) * height);
+	}
+	else
+	{
+		//pBuf = (T*)malloc( sizeof(T) * width * height );
+		pBuf = (T*)malloc(lineWidth * height);
+		pData = (T**)malloc(sizeof(T*) * height);
+	}
+
+	for (int i = 0; i < height; ++i)
+	{
+		//pData[i] = pBuf + width * i;
+		pData[i] = (T*)((char*)pBuf + lineWidth * i);
+	}
+
+}
+
+template< typename T>
+void DynamicMatrix<T>::attach(T* pBuf, int width, int height, int alignBytes)
+{
+	freeMatrix();
+
+	ownsData = false;
+	this->alignBytes = alignBytes;
+	this->width = pBuf ? width : 0;
+	this->height = pBuf ? height : 0;
+	if (!pBuf || height <= 0) return;
+
+	int lineWidth = getLineWidth();
+	pData = (T**)malloc(sizeof(T*) * height);
+	for (int i = 0; i < height; ++i)
+	{
+		pData[i] = (T*)((char*)pBuf + lineWidth * i);
+	}
+}
+
+template< typename T>
+T* DynamicMatrix<T>::operator[](int i)
+{
+	return pData[i];
+}
+
+template< typename T>
+void DynamicMatrix<T>::freeMatrix()
+{
+	if (pData)
+	{
+		if (ownsData) free(pData[0]);
+		free(pData);
+		pData = 0;
+	}
+}
+
+template< typename T >
+template< typename U>
+void DynamicMatrix<T>::makePattern(const U& value, unsigned char* pattern)
+{
+	if (sizeof(U) == 1)
+	{
+		memset(pattern, *(const unsigned char*)&value, sizeof(T));
+	}
+	else
+	{
+		memset(pattern, 0, sizeof(T));
+		memcpy(pattern, &value, sizeof(T) < sizeof(U) ? sizeof(T) : sizeof(U));
+	}
+}
+
+template< typename T >
+void DynamicMatrix<T>::fillElements(T* p, size_t count, const unsigned char* pattern, bool streaming)
+{
+	bool sameBytes = true;
+	for (size_t k = 1; k < sizeof(T); ++k)
+	{
+		if (pattern[k] != pattern[0]) { sameBytes = false; break; }
+	}
+
+	if (sameBytes)
+	{
+		memset(p, pattern[0], count * sizeof(T));
+	}
+	else if (sizeof(T) == 4)
+	{
+		unsigned value;
+		memcpy(&value, pattern, 4);
+		_fillDWords((unsigned*)p, count, value, streaming);
+	}
+	else
+	{
+		for (size_t j = 0; j < count; ++j)
+		{
+			memcpy(p + j, pattern, sizeof(T));
+		}
+	}
+}
+
+template< typename T >
+template< typename U>
+void DynamicMatrix<T>::clear(const U& value)
+{
+	if (!pData || !pData[0]) return;
+
+	unsigned char pattern[sizeof(T)];
+	makePattern(value, pattern);
+
+	int lineWidth = getLineWidth();
+	bool streaming = (size_t)lineWidth * height >= STREAMING_CLEAR_BYTES;
+
+	if (lineWidth == width * (int)sizeof(T))
+	{
+		//行间没有对齐填充，整个缓冲区一次填充
+		fillElements(pData[0], (size_t)width * height, pattern, streaming);
+	}
+	else
+	{
+		for (int i = 0; i < height; ++i)
+		{
+			fillElements(pData[i], width, pattern, streaming);
+		}
+	}
+
+#ifdef DYNAMICMATRIX_SSE2
+	if (streaming) _mm_sfence();
+#endif
+}
+
+template<typename T>
+template<typename U>
+void DynamicMatrix<T>::clear(int x, int y, int size_x, int size_y, const U& value)
+{
+	if (!pData || !pData[0]) return;
+
+	//裁剪到矩阵范围内
+	int xend = x + size_x;
+	int yend = y + size_y;
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	if (xend > width) xend = width;
+	if (yend > height) yend = height;
+	if (x >= xend || y >= yend) return;
+
+	unsigned char pattern[sizeof(T)];
+	makePattern(value, pattern);
+
+	bool streaming = (size_t)(xend - x) * (yend - y) * sizeof(T) >= STREAMING_CLEAR_BYTES;
+
+	if (x == 0 && xend == width && getLineWidth() == width * (int)sizeof(T))
+	{
+		fillElements(pData[y], (size_t)width * (yend - y), pattern, streaming);
+	}
+	else
+	{
+		for (int i = y; i < yend; ++i)
+		{
+			fillElements(pData[i] + x, xend - x, pattern, streaming);
+		}
+	}
+
+#ifdef DYNAMICMATRIX_SSE2
+	if (streaming) _mm_sfence();
+#endif
+}
@@ -2,8 +2,12 @@
 
 #include <vector>
 #include <algorithm>
+#include <float.h>
 #include "Graphic.h"
 #include "Define.h"
+#include "GeometryArena.h"
+#include "RTree.h"
+#include "HitTest.h"
 
 using namespace std;
 #include <string>
@@ -38,6 +42,7 @@ struct _Box2D
 	T ymin(){ return _ymin;}
 	T xmax(){ return _xmax;}
 	T ymax(){ return _ymax;}
+	bool isValid(){ return valid; }// 是否有效
 
 	void setBox( T xmin,T ymin , T xmax, T ymax )// 设置边界框范围
 	{
@@ -105,10 +110,14 @@ struct Geometry
 	virtual Box2D getEnvelop() = 0;// 获取几何对象边界框
 	string label;
 	int operationType; // 操作类型，用于区分绘制和填充模式
+	bool inArena; // 是否在GeometryArena中构造，是则只调用析构函数，内存随分配器整体释放
 	
-	Geometry() : operationType(0) {} // 构造函数初始化
+	Geometry() : operationType(0), inArena(false) {} // 构造函数初始化
 };
 
+// 点数组，pArena不为NULL时从分配器中分配
+typedef vector<Point2D, ArenaAllocator<Point2D> > Point2DArray;
+
 // 点几何对象
 struct PointGeometry:Geometry
 {
@@ -131,11 +140,17 @@ struct PointGeometry:Geometry
 // 线几何对象
 struct PolylineGeometry:Geometry
 {
+	// pArena为点数组使用的分配器，为NULL时使用堆
+	PolylineGeometry( GeometryArena* pArena = NULL ) : pts( ArenaAllocator<Point2D>( pArena ) ) {}
+
 	virtual GeomType getGeomType(){ return gtPolyline; }
 
 	// 数组重载，获取第i个点
 	Point2D& operator[]( int i ){ return pts[i]; }
 
+	// 预留count个点的空间，已知点数时避免逐个添加时反复扩容
+	void reserve( int count ){ pts.reserve( count ); }
+
 	// 添加点
 	void addPoint( double x, double y )
 	{
@@ -160,20 +175,43 @@ struct PolylineGeometry:Geometry
 	{
 		return pts;
 	}*/
-	vector<Point2D>& getPts()
+	Point2DArray& getPts()
 	{
 		return pts;
 	}
 protected:
 	// 所有点
-	vector<Point2D> pts;
+	Point2DArray pts;
 	Box2D envelop;
 };
 
-// 多边形几何对象
+// 多边形几何对象，可以由多个环组成（外环和洞、多个多边形），所有环的点连续存放在pts中
 struct PolygonGeometry:PolylineGeometry
 {
+	PolygonGeometry( GeometryArena* pArena = NULL ) : PolylineGeometry( pArena ), ringOffsets( ArenaAllocator<int>( pArena ) ) {}
+
 	virtual GeomType getGeomType(){ return gtPolygon; }
+
+	// 开始一个新的环，之后添加的点属于新环
+	void beginRing()
+	{
+		int offset = pts.size();
+		if (offset > getRingOffset(getRingCount() - 1)) ringOffsets.push_back(offset);
+	}
+
+	// 获取环的数量
+	int getRingCount(){ return ringOffsets.size() + 1; }
+
+	// 获取第i个环的第一个点在pts中的下标，i等于环的数量时返回点数，第i个环为[getRingOffset(i), getRingOffset(i + 1))
+	int getRingOffset( int i )
+	{
+		if (i == 0) return 0;
+		return i <= (int)ringOffsets.size() ? ringOffsets[i - 1] : (int)pts.size();
+	}
+
+	FillRule fillRule = frEvenOdd;// 填充规则，决定环之间重叠的区域（如洞）是否填充
+protected:
+	vector<int, ArenaAllocator<int> > ringOffsets;// 第二个环起各环的起始下标
 };
 
 // 圆几何对象
@@ -238,6 +276,155 @@ struct EllipseGeometry :Geometry
 //	Symbol* pSymbol;
 //};
 
+// 列式存储中一个几何对象的只读视图，不需要虚函数即可取得类型和坐标
+struct GeometryRecord
+{
+	GeomType type;
+	int operationType;
+	FillRule fillRule;// 多边形的填充规则
+	const Point2D* pts;// 对象的坐标：点为1个点，线和多边形为所有顶点，圆为圆心和(r, r)，椭圆为两个对角点
+	int count;// 坐标数
+	const int* ringOffsets;// 多边形各环的起始下标（相对pts），共ringCount + 1项，最后一项为count；其他类型为NULL
+	int ringCount;
+
+	// 由几何对象直接生成记录，不复制坐标：线和多边形的pts指向对象的点数组，点、圆、椭圆的坐标写入points
+	// 多边形各环的起始下标追加到rings末尾，ringOffsets指向这些项；记录使用期间对象、points和rings不能修改
+	static GeometryRecord fromGeometry( Geometry* pGeometry, Point2D points[2], vector<int>& rings )
+	{
+		GeometryRecord record;
+		record.type = pGeometry->getGeomType();
+		record.operationType = pGeometry->operationType;
+		record.fillRule = frEvenOdd;
+		record.pts = points;
+		record.count = 0;
+		record.ringOffsets = NULL;
+		record.ringCount = 0;
+		switch (record.type)
+		{
+		case gtPoint:
+		{
+			PointGeometry* pPoint = (PointGeometry*)pGeometry;
+			points[0] = Point2D(pPoint->x, pPoint->y);
+			record.count = 1;
+		}
+		break;
+		case gtPolyline:
+		case gtPolygon:
+		{
+			PolylineGeometry* pPolyline = (PolylineGeometry*)pGeometry;
+			const Point2DArray& pts = pPolyline->getPts();
+			record.pts = pts.data();
+			record.count = (int)pts.size();
+			if (record.type == gtPolygon)
+			{
+				PolygonGeometry* pPolygon = (PolygonGeometry*)pGeometry;
+				size_t first = rings.size();
+				record.ringCount = pPolygon->getRingCount();
+				for (int i = 0; i <= record.ringCount; ++i) rings.push_back(pPolygon->getRingOffset(i));
+				record.ringOffsets = rings.data() + first;
+				record.fillRule = pPolygon->fillRule;
+			}
+		}
+		break;
+		case gtCircle:
+		{
+			CircleGeometry* pCircle = (CircleGeometry*)pGeometry;
+			points[0] = Point2D(pCircle->x, pCircle->y);
+			points[1] = Point2D(pCircle->r, pCircle->r);
+			record.count = 2;
+		}
+		break;
+		case gtEllipse:
+		{
+			EllipseGeometry* pEllipse = (EllipseGeometry*)pGeometry;
+			points[0] = Point2D(pEllipse->x1, pEllipse->y1);
+			points[1] = Point2D(pEllipse->x2, pEllipse->y2);
+			record.count = 2;
+		}
+		break;
+		default:
+			break;
+		}
+		return record;
+	}
+};
+
+// 图层几何对象的列式存储：按对象顺序把类型、操作类型、边界框分别存放在各自的数组中，所有对象的坐标连续存放在一个数组中
+// 绘制时按下标顺序线性读取，不需要逐个访问堆上的对象、调用虚函数
+// 几何对象仍是图层对外的数据（可以通过geometrySet、getPts直接修改），列式存储是由它们生成的副本，按图层的版本号重新生成
+// 副本每个对象约多占46字节加每个坐标16字节，换来绘制、查询时连续的内存访问
+struct GeometryColumns
+{
+	GeometryColumns(){ clear(); }
+
+	// 获取对象数量
+	int size() const { return (int)types.size(); }
+
+	// 清空所有对象
+	void clear()
+	{
+		types.clear();
+		operationTypes.clear();
+		fillRules.clear();
+		xmin.clear(), ymin.clear(), xmax.clear(), ymax.clear();
+		coordOffsets.assign(1, 0);
+		coords.clear();
+		ringIndex.assign(1, 0);
+		rings.clear();
+	}
+
+	// 在末尾添加一个几何对象的数据
+	void append( Geometry* pGeometry )
+	{
+		// 多边形的环下标直接追加到rings中
+		Point2D points[2];
+		GeometryRecord record = GeometryRecord::fromGeometry(pGeometry, points, rings);
+		coords.insert(coords.end(), record.pts, record.pts + record.count);
+
+		types.push_back((unsigned char)record.type);
+		operationTypes.push_back(record.operationType);
+		fillRules.push_back((unsigned char)record.fillRule);
+		Box2D box = pGeometry->getEnvelop();
+		bool valid = box.isValid();
+		xmin.push_back(valid ? box.xmin() : DBL_MAX);
+		ymin.push_back(valid ? box.ymin() : DBL_MAX);
+		xmax.push_back(valid ? box.xmax() : -DBL_MAX);
+		ymax.push_back(valid ? box.ymax() : -DBL_MAX);
+		coordOffsets.push_back((int)coords.size());
+		ringIndex.push_back((int)rings.size());
+	}
+
+	// 获取第i个对象
+	GeometryRecord get( int i ) const
+	{
+		GeometryRecord record;
+		record.type = (GeomType)types[i];
+		record.operationType = operationTypes[i];
+		record.fillRule = (FillRule)fillRules[i];
+		record.pts = coords.data() + coordOffsets[i];
+		record.count = coordOffsets[i + 1] - coordOffsets[i];
+		int ringEntries = ringIndex[i + 1] - ringIndex[i];
+		record.ringOffsets = ringEntries > 0 ? rings.data() + ringIndex[i] : NULL;
+		record.ringCount = ringEntries > 0 ? ringEntries - 1 : 0;
+		return record;
+	}
+
+	vector<unsigned char> types;// 各对象的类型GeomType
+	vector<int> operationTypes;// 各对象的操作类型
+	vector<unsigned char> fillRules;// 各对象的填充规则FillRule，只对多边形有效
+	vector<double> xmin, ymin, xmax, ymax;// 各对象的边界框，没有坐标的对象xmin > xmax
+	vector<int> coordOffsets;// 第i个对象的坐标为coords[coordOffsets[i]]到coords[coordOffsets[i + 1] - 1]，共size() + 1项
+	vector<Point2D> coords;// 所有对象的坐标
+	vector<int> ringIndex;// 第i个对象在rings中的项为rings[ringIndex[i]]到rings[ringIndex[i + 1] - 1]，共size() + 1项
+	vector<int> rings;// 多边形各环的起始下标（相对对象的第一个坐标），每个多边形比环数多一项（点数）
+};
+
+// 图层的绘制缓存基类，由绘制模块派生，随图层一起删除
+struct LayerCache
+{
+	virtual ~LayerCache() {}
+};
+
 // 图层
 struct Layer
 {
@@ -253,28 +440,49 @@ struct Layer
 
 	virtual ~Layer()
 	{
-		for( size_t i = 0 , size = geometrySet.size(); i < size ; ++i ) delete geometrySet[i];// 析构时删除所有几何对象
+		destroyGeometries();// 析构时删除所有几何对象，分配器中的内存随arena一起释放
+		delete pCache;
 	}
 
+	// 图层拥有其中的几何对象和绘制缓存，不能复制
+	Layer(const Layer&) = delete;
+	Layer& operator=(const Layer&) = delete;
+
 	// 数组重载，返回第i个几何对象
 	Geometry* operator[]( int i ){ return geometrySet[i]; }
 
 	// 清空图层中的所有几何对象
 	void clear()
 	{
-		for (size_t i = 0, size = geometrySet.size(); i < size; ++i) {
-			delete geometrySet[i];
-		}
+		destroyGeometries();
 		geometrySet.clear();
+		arena.release();
 		envelop.setBox(0, 0, 0, 0); // 重置边界框
+		++version;
+		columns.clear();
+		columnsVersion = version;
+		rtree.clear();
 	}
 
-	// 添加几何对象
+	// 获取图层的几何对象分配器，传给GeometryFactory后创建的对象从中分配，随clear()和图层析构整体释放
+	GeometryArena* getArena(){ return &arena; }
+
+	// 添加几何对象，pGeometry由new创建或在本图层的分配器中创建，之后归图层所有
 	void addGeometry(Geometry* pGeometry, bool updateEnvelop = false )
 	{
 		geometrySet.push_back( pGeometry );
+		bool columnsCurrent = columnsVersion == version;
+		++version;
+		if (columnsCurrent)
+		{
+			columns.append(pGeometry);
+			columnsVersion = version;
+		}
 		if(updateEnvelop )
-			envelop.expand( (Box2D&) pGeometry->getEnvelop());
+		{
+			Box2D box = pGeometry->getEnvelop();
+			envelop.expand( box );
+		}
 	}
 
 	// 设置图层范围
@@ -286,10 +494,107 @@ struct Layer
 	// 获取图层中几何对象数量
 	int getGeometryCount(){ return geometrySet.size(); }
 
+	// 获取所有几何对象的列式存储，供绘制时线性遍历；直接修改几何对象（version改变）后重新生成
+	const GeometryColumns& getColumns()
+	{
+		if (columnsVersion != version)
+		{
+			columns.clear();
+			for (size_t i = 0, size = geometrySet.size(); i < size; ++i) columns.append(geometrySet[i]);
+			columnsVersion = version;
+			rtree.clear();// 对象的范围可能已改变
+		}
+		return columns;
+	}
+
+	// 查询边界框与矩形[xmin, xmax] × [ymin, ymax]相交的几何对象，序号按从小到大（绘制顺序）写入result
+	// R树在第一次查询时装载；之后添加的对象较少时逐个判断，超过已索引对象的1/8时重新装载
+	void queryGeometries( double xmin, double ymin, double xmax, double ymax, vector<int>& result )
+	{
+		const GeometryColumns& columns = getColumns();
+		int size = columns.size();
+		int indexed = rtree.getCount();
+		if (size - indexed > max(256, indexed / 8))
+		{
+			rtree.build(columns.xmin.data(), columns.ymin.data(), columns.xmax.data(), columns.ymax.data(), size);
+			indexed = size;
+		}
+
+		result.clear();
+		rtree.query(xmin, ymin, xmax, ymax, result);
+		sort(result.begin(), result.end());
+		for (int i = indexed; i < size; ++i)
+		{
+			if (columns.xmin[i] <= xmax && columns.xmax[i] >= xmin && columns.ymin[i] <= ymax && columns.ymax[i] >= ymin) result.push_back(i);
+		}
+	}
+
+	// 由列式存储求所有几何对象的边界框，与添加时是否更新envelop无关；图层为空时返回无效的边界框
+	Box2D computeExtent()
+	{
+		const GeometryColumns& columns = getColumns();
+		Box2D box;
+		for (int i = 0, size = columns.size(); i < size; ++i)
+		{
+			box.expand(columns.xmin[i], columns.ymin[i]);
+			box.expand(columns.xmax[i], columns.ymax[i]);
+		}
+		return box;
+	}
+
+	// 点选：拾取点(x, y)处的几何对象，线和轮廓在tolerance距离内即可拾取，填充的图形在内部也可拾取
+	// 先用R树按边界框筛选，再逐个精确判断（见HitTest）；多个对象重叠时返回最后绘制（最上面）的一个
+	// @return 几何对象的序号，没有时返回-1
+	int pickGeometry( double x, double y, double tolerance )
+	{
+		vector<int> candidates;
+		queryGeometries(x - tolerance, y - tolerance, x + tolerance, y + tolerance, candidates);
+		const GeometryColumns& columns = getColumns();
+		for (int i = (int)candidates.size() - 1; i >= 0; --i)
+		{
+			if (HitTest::hitPoint(columns.get(candidates[i]), x, y, tolerance)) return candidates[i];
+		}
+		return -1;
+	}
+
+	// 框选：与矩形[xmin, xmax] × [ymin, ymax]相交的所有几何对象，序号按从小到大写入result
+	void selectGeometries( double xmin, double ymin, double xmax, double ymax, vector<int>& result )
+	{
+		queryGeometries(xmin, ymin, xmax, ymax, result);
+		const GeometryColumns& columns = getColumns();
+		size_t count = 0;
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			if (HitTest::hitRect(columns.get(result[i]), xmin, ymin, xmax, ymax)) result[count++] = result[i];
+		}
+		result.resize(count);
+	}
+
 	vector<Geometry*> geometrySet;// 几何对象集合
 	Box2D envelop;// 图层范围对应的边界框
 	GeomType geomType;// 图层类型
 	Color layerColor = BLACK;// 图层颜色
+	unsigned version = 0;// 版本号，添加、删除几何对象时加1，直接修改几何对象后也应加1，绘制缓存据此判断是否失效
+	LayerCache* pCache = NULL;// 绘制缓存，由绘制模块创建
+	bool cacheRaster = false;// 是否缓存图层的绘制结果，开启后图层未修改时重绘只需合成缓存的位图
+	bool spatialIndex = false;// 是否按空间索引裁剪，开启后绘制时只回放边界框与可见区域相交的几何对象（见queryGeometries）
+
+protected:
+	// 删除所有几何对象：分配器中的对象只调用析构函数，其余的delete
+	void destroyGeometries()
+	{
+		for (size_t i = 0, size = geometrySet.size(); i < size; ++i)
+		{
+			Geometry* pGeometry = geometrySet[i];
+			if (pGeometry && pGeometry->inArena) pGeometry->~Geometry();
+			else delete pGeometry;
+		}
+	}
+
+	GeometryColumns columns;// 几何对象的列式存储，与geometrySet中的对象一一对应，geometrySet作为按对象访问的兼容接口
+	unsigned columnsVersion = 0;// columns对应的版本号
+	GeometryArena arena;// 几何对象及其坐标数组的分配器
+	RTree rtree;// 几何对象边界框的R树，索引columns中的前rtree.getCount()个对象
 };
 
 // 数据集
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// 几何对象的单调分配器：从依次增大的大块内存中顺序切分，单个对象不归还，release()时整体释放
+/// 图层加载、清空大量几何对象时只有少量的大块分配，不再为每个对象和坐标数组调用malloc/free
+class GeometryArena
+{
+public:
+	GeometryArena() : pCurrent(NULL), pEnd(NULL), nextBlockSize(MIN_BLOCK_SIZE) {}
+	~GeometryArena() { release(); }
+
+	/// 分配size字节，起始地址按align（2的幂）对齐
+	void* allocate(size_t size, size_t align)
+	{
+		char* p = pCurrent ? alignUp(pCurrent, align) : NULL;
+		if (p == NULL || size > (size_t)(pEnd - p))
+		{
+			size_t required = size + align;
+			// 超过一块的一半的请求单独分配一块，当前块剩余的空间继续使用
+			if (required > nextBlockSize / 2) return alignUp(newBlock(required), align);
+
+			char* pBlock = newBlock(nextBlockSize);
+			pEnd = pBlock + nextBlockSize;
+			if (nextBlockSize < MAX_BLOCK_SIZE) nextBlockSize *= 2;
+			p = alignUp(pBlock, align);
+		}
+		pCurrent = p + size;
+		return p;
+	}
+
+	/// 在分配器中构造T类型的对象，对象不能delete，需要时显式调用析构函数，内存由release()释放
+	template<class T, class... Args>
+	T* create(Args&&... args)
+	{
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/// 释放所有内存，之前分配的对象全部失效
+	void release()
+	{
+		for (size_t i = 0; i < blocks.size(); ++i) free(blocks[i]);
+		blocks.clear();
+		pCurrent = pEnd = NULL;
+		nextBlockSize = MIN_BLOCK_SIZE;
+	}
+
+	/// 已向系统申请的内存块数
+	int getBlockCount() const { return (int)blocks.size(); }
+
+private:
+	GeometryArena(const GeometryArena&);
+	GeometryArena& operator=(const GeometryArena&);
+
+	static char* alignUp(char* p, size_t align)
+	{
+		return (char*)(((size_t)p + align - 1) & ~(align - 1));
+	}
+
+	char* newBlock(size_t size)
+	{
+		char* pBlock = (char*)malloc(size);
+		if (pBlock == NULL) throw std::bad_alloc();
+		blocks.push_back(pBlock);
+		return pBlock;
+	}
+
+	static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+	static const size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+	std::vector<char*> blocks;// 所有内存块
+	char* pCurrent;// 当前块中下一次分配的位置
+	char* pEnd;// 当前块的末尾
+	size_t nextBlockSize;// 下一块的大小，从MIN_BLOCK_SIZE开始每次加倍，最大为MAX_BLOCK_SIZE
+};
+
+/// 从GeometryArena分配内存的STL分配器，用于几何对象内部的坐标数组；pArena为NULL时使用operator new
+/// 分配器中的内存不单独归还，数组扩容后旧的缓冲区留到GeometryArena::release()时释放
+template<class T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	ArenaAllocator(GeometryArena* pArena = NULL) : pArena(pArena) {}
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : pArena(other.pArena) {}
+
+	T* allocate(size_t n)
+	{
+		if (pArena) return (T*)pArena->allocate(n * sizeof(T), alignof(T));
+		return (T*)::operator new(n * sizeof(T));
+	}
+
+	void deallocate(T* p, size_t)
+	{
+		if (pArena == NULL) ::operator delete(p);
+	}
+
+	GeometryArena* pArena;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.pArena == b.pArena; }
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.pArena != b.pArena; }
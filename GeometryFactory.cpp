@@ -1,14 +1,26 @@
 #include "GeometryFactory.h"
 #include "Graphic.h"
+#include <math.h>
 
-Geometry* GeometryFactory::createPointGeometry(double x, double y)
+/// 创建T类型的几何对象，pArena不为NULL时在分配器中构造
+template<class T, class... Args>
+static T* newGeometry(GeometryArena* pArena, Args... args)
 {
-	return new PointGeometry(x, y);
+	if (pArena == NULL) return new T(args...);
+	T* pGeometry = pArena->create<T>(args...);
+	pGeometry->inArena = true;
+	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolylineGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::createPointGeometry(double x, double y, GeometryArena* pArena)
 {
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	return newGeometry<PointGeometry>(pArena, x, y);
+}
+
+Geometry* GeometryFactory::createPolylineGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
+{
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size ; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -16,9 +28,10 @@ Geometry* GeometryFactory::createPolylineGeometry(PixelPoint* pts, int size)
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolylineGeometry(Point2D* pts, int size)
+Geometry* GeometryFactory::createPolylineGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -26,17 +39,18 @@ Geometry* GeometryFactory::createPolylineGeometry(Point2D* pts, int size)
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolylineGeometry(PixelPoint& pt1, PixelPoint& pt2)
+Geometry* GeometryFactory::createPolylineGeometry(PixelPoint& pt1, PixelPoint& pt2, GeometryArena* pArena)
 {
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
 	pGeometry->addPoint(pt1.x, pt1.y);
 	pGeometry->addPoint(pt2.x, pt2.y);
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolygonGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::createPolygonGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
 {
-	PolygonGeometry* pGeometry = new PolygonGeometry();
+	PolygonGeometry* pGeometry = newGeometry<PolygonGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -44,9 +58,10 @@ Geometry* GeometryFactory::createPolygonGeometry(PixelPoint* pts, int size)
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolygonOutlineGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::createPolygonOutlineGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
 {
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -55,9 +70,10 @@ Geometry* GeometryFactory::createPolygonOutlineGeometry(PixelPoint* pts, int siz
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolygonGeometry(Point2D* pts, int size)
+Geometry* GeometryFactory::createPolygonGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
-	PolygonGeometry* pGeometry = new PolygonGeometry();
+	PolygonGeometry* pGeometry = newGeometry<PolygonGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -65,9 +81,26 @@ Geometry* GeometryFactory::createPolygonGeometry(Point2D* pts, int size)
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createPolygonOutlineGeometry(Point2D* pts, int size)
+Geometry* GeometryFactory::createPolygonGeometry(Point2D* pts, const int* ringOffsets, int ringCount, FillRule rule, GeometryArena* pArena)
+{
+	PolygonGeometry* pGeometry = newGeometry<PolygonGeometry>(pArena, pArena);
+	if (ringCount > 0) pGeometry->reserve(ringOffsets[ringCount] - ringOffsets[0]);
+	for (int r = 0; r < ringCount; ++r)
+	{
+		pGeometry->beginRing();
+		for (int i = ringOffsets[r]; i < ringOffsets[r + 1]; ++i)
+		{
+			pGeometry->addPoint(pts[i].x, pts[i].y);
+		}
+	}
+	pGeometry->fillRule = rule;
+	return pGeometry;
+}
+
+Geometry* GeometryFactory::createPolygonOutlineGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
+	pGeometry->reserve(size);
 	for (int i = 0; i < size; ++i)
 	{
 		pGeometry->addPoint(pts[i].x, pts[i].y);
@@ -76,44 +109,57 @@ Geometry* GeometryFactory::createPolygonOutlineGeometry(Point2D* pts, int size)
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::createCircleGeometry(double x, double y, double r)
+Geometry* GeometryFactory::createCircleGeometry(double x, double y, double r, GeometryArena* pArena)
 {
-	return new CircleGeometry(x, y, r );
+	return newGeometry<CircleGeometry>(pArena, x, y, r);
 }
 
-Geometry* GeometryFactory::createCircleGeometry(double x1, double y1, double x2, double y2)
+Geometry* GeometryFactory::createCircleGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena)
 {
 	double dx = x1 - x2;
 	double dy = y1 - y2;
-	return new CircleGeometry( x1, y1, sqrt(dx * dx + dy * dy));
+	return newGeometry<CircleGeometry>(pArena, x1, y1, sqrt(dx * dx + dy * dy));
+}
+
+Geometry* GeometryFactory::createCircleGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
+{
+	if (size < 2) return NULL;
+	return createCircleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::createCircleGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::createCircleGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return createCircleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return createCircleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::createEllipseGeometry(double x1, double y1, double x2, double y2)
+Geometry* GeometryFactory::createEllipseGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena)
 {
 	if (x1 > x2)swap(x1, x2);
 	if (y1 > y2)swap(y1, y2);
 
-	return new EllipseGeometry(x1, y1, x2, y2 );
+	return newGeometry<EllipseGeometry>(pArena, x1, y1, x2, y2);
+}
+
+Geometry* GeometryFactory::createEllipseGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
+{
+	if (size < 2) return NULL;
+	return createEllipseGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::createEllipseGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::createEllipseGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return createEllipseGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return createEllipseGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::creatRectangleGeometry(double x1, double y1, double x2, double y2)
+Geometry* GeometryFactory::creatRectangleGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena)
 {
 	if (x1 > x2)swap(x1, x2);
 	if (y1 > y2)swap(y1, y2);
 
-	PolygonGeometry* pGeometry = new PolygonGeometry();
+	PolygonGeometry* pGeometry = newGeometry<PolygonGeometry>(pArena, pArena);
+	pGeometry->reserve(4);
 	pGeometry->addPoint(x1, y1);
 	pGeometry->addPoint(x2, y1);
 	pGeometry->addPoint(x2, y2);
@@ -121,24 +167,25 @@ Geometry* GeometryFactory::creatRectangleGeometry(double x1, double y1, double x
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::creatRectangleGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::creatRectangleGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return creatRectangleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return creatRectangleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::creatRectangleGeometry(Point2D* pts, int size)
+Geometry* GeometryFactory::creatRectangleGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return creatRectangleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return creatRectangleGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::creatRectangleOutlineGeometry(double x1, double y1, double x2, double y2)
+Geometry* GeometryFactory::creatRectangleOutlineGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena)
 {
 	if (x1 > x2)swap(x1, x2);
 	if (y1 > y2)swap(y1, y2);
 
-	PolylineGeometry* pGeometry = new PolylineGeometry();
+	PolylineGeometry* pGeometry = newGeometry<PolylineGeometry>(pArena, pArena);
+	pGeometry->reserve(5);
 	pGeometry->addPoint(x1, y1);
 	pGeometry->addPoint(x2, y1);
 	pGeometry->addPoint(x2, y2);
@@ -148,14 +195,14 @@ Geometry* GeometryFactory::creatRectangleOutlineGeometry(double x1, double y1, d
 	return pGeometry;
 }
 
-Geometry* GeometryFactory::creatRectangleOutlineGeometry(PixelPoint* pts, int size)
+Geometry* GeometryFactory::creatRectangleOutlineGeometry(PixelPoint* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return creatRectangleOutlineGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return creatRectangleOutlineGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
 
-Geometry* GeometryFactory::creatRectangleOutlineGeometry(Point2D* pts, int size)
+Geometry* GeometryFactory::creatRectangleOutlineGeometry(Point2D* pts, int size, GeometryArena* pArena)
 {
 	if (size < 2) return NULL;
-	return creatRectangleOutlineGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y);
+	return creatRectangleOutlineGeometry(pts[0].x, pts[0].y, pts[1].x, pts[1].y, pArena);
 }
@@ -3,33 +3,38 @@
 #include "GeoDefine.h"
 
 struct PixelPoint;
+// 几何对象工厂，pArena不为NULL时对象及其坐标数组从分配器中分配（通常为Layer::getArena()），只能加入该分配器所属的图层
 class GeometryFactory
 {
 public :
-	static Geometry* createPointGeometry( double x, double y );
+	static Geometry* createPointGeometry( double x, double y, GeometryArena* pArena = NULL);
 
-	static Geometry* createPolylineGeometry( PixelPoint* pts, int size);
-	static Geometry* createPolylineGeometry(Point2D* pts, int size);
-	static Geometry* createPolylineGeometry(PixelPoint& pt1, PixelPoint& pt2);
+	static Geometry* createPolylineGeometry( PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createPolylineGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createPolylineGeometry(PixelPoint& pt1, PixelPoint& pt2, GeometryArena* pArena = NULL);
 
-	static Geometry* createPolygonGeometry( PixelPoint* pts, int size);	
-	static Geometry* createPolygonGeometry(Point2D* pts, int size);
+	static Geometry* createPolygonGeometry( PixelPoint* pts, int size, GeometryArena* pArena = NULL);	
+	static Geometry* createPolygonGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	// 创建多个环组成的多边形，第i个环为pts[ringOffsets[i]]到pts[ringOffsets[i + 1] - 1]
+	static Geometry* createPolygonGeometry(Point2D* pts, const int* ringOffsets, int ringCount, FillRule rule = frEvenOdd, GeometryArena* pArena = NULL);
 
-	static Geometry* createPolygonOutlineGeometry(PixelPoint* pts, int size);
-	static Geometry* createPolygonOutlineGeometry(Point2D* pts, int size);
+	static Geometry* createPolygonOutlineGeometry(PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createPolygonOutlineGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
 	
-	static Geometry* createCircleGeometry(PixelPoint* pts, int size);
-	static Geometry* createCircleGeometry(double x, double y , double r );
-	static Geometry* createCircleGeometry(double x1, double y1, double x2, double y2);
+	static Geometry* createCircleGeometry(PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createCircleGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createCircleGeometry(double x, double y , double r, GeometryArena* pArena = NULL);
+	static Geometry* createCircleGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena = NULL);
 	
-	static Geometry* createEllipseGeometry(PixelPoint* pts, int size);
-	static Geometry* createEllipseGeometry(double x1, double y1, double x2, double y2 );
-	static Geometry* creatRectangleGeometry(PixelPoint* pts, int size);
-	static Geometry* creatRectangleGeometry(Point2D* pts, int size);
-	static Geometry* creatRectangleGeometry(double x1, double y1, double x2, double y2);
+	static Geometry* createEllipseGeometry(PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createEllipseGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* createEllipseGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena = NULL);
+	static Geometry* creatRectangleGeometry(PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* creatRectangleGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* creatRectangleGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena = NULL);
 
-	static Geometry* creatRectangleOutlineGeometry(PixelPoint* pts, int size);
-	static Geometry* creatRectangleOutlineGeometry(Point2D* pts, int size);
-	static Geometry* creatRectangleOutlineGeometry(double x1, double y1, double x2, double y2);
+	static Geometry* creatRectangleOutlineGeometry(PixelPoint* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* creatRectangleOutlineGeometry(Point2D* pts, int size, GeometryArena* pArena = NULL);
+	static Geometry* creatRectangleOutlineGeometry(double x1, double y1, double x2, double y2, GeometryArena* pArena = NULL);
 };
 
@@ -6,245 +6,19 @@ purpose:	图形库实现
 version:    1.0
 *********************************************************************/
 #include "Graphic.h"
+
+#ifndef HEADLESS
+
 #include <windows.h>
 #include <math.h>
 #include <vector>
 #include <assert.h>
 #include <locale.h>
+#include "DynamicMatrix.h"
+#include "DirtyRect.h"
 
 using namespace std;
 
-#pragma region DynamicMatrix
-template< typename T>
-class DynamicMatrix
-{
-public:
-	DynamicMatrix(int alignBytes = 1) { this->alignBytes = alignBytes; pData = 0; width = height = 0; }
-	~DynamicMatrix(void);
-
-	void freeMatrix();
-	T* operator[](int i);
-	void setSize(int width, int height);
-	T* dataPtr()const { return pData ? pData[0] : 0; }
-	template<class U> void clear(const U& value);
-	template<class U> void clear(int x, int y, int size_x, int size_y, const U& value);
-	bool valid()const { return pData || width > 0 || height > 0; }
-	int getLineWidth();
-
-	int alignBytes;
-	int width, height;
-	T** pData;
-};
-
-template< class T>
-DynamicMatrix<T>::~DynamicMatrix(void)
-{
-	freeMatrix();
-}
-
-template< typename T>
-int DynamicMatrix<T>::getLineWidth()
-{
-	return (width * sizeof(T) + alignBytes - 1) / alignBytes * alignBytes;
-}
-
-template< typename T>
-void DynamicMatrix<T>::setSize(int width, int height)
-{
-	if (width == this->width && height == this->height) return;
-
-	this->width = width;
-	this->height = height;
-
-	//freeMatrix();	
-
-	int lineWidth = getLineWidth();
-	T* pBuf;
-	if (pData)
-	{
-		pBuf = (T*)realloc(pData[0], lineWidth * height);
-		pData = (T**)realloc(pData, sizeof(T*) * height);
-	}
-	else
-	{
-		//pBuf = (T*)malloc( sizeof(T) * width * height );
-		pBuf = (T*)malloc(lineWidth * height);
-		pData = (T**)malloc(sizeof(T*) * height);
-	}
-
-	for (int i = 0; i < height; ++i)
-	{
-		//pData[i] = pBuf + width * i;
-		pData[i] = (T*)((char*)pBuf + lineWidth * i);
-	}
-
-}
-
-template< typename T>
-T* DynamicMatrix<T>::operator[](int i)
-{
-	return pData[i];
-}
-
-template< typename T>
-void DynamicMatrix<T>::freeMatrix()
-{
-	if (pData)
-	{
-		free(pData[0]);
-		free(pData);
-		pData = 0;
-	}
-}
-
-template< typename T >
-template< typename U>
-void DynamicMatrix<T>::clear(const U& value)
-{
-	if (!pData || !pData[0]) return;
-
-	T* p = pData[0];
-	int lineWidth = getLineWidth();
-	if (sizeof(U) == 1)
-	{
-		memset(p, value, lineWidth * height);
-		//memset( pData[0],value, sizeof(T) * width * height );
-	}
-	else
-	{
-		unsigned val = (unsigned&)value & 0xFF;
-		if (val == (unsigned&)value)
-		{
-			memset(p, val, lineWidth * height);
-		}
-		else
-		{
-			int sizeT = sizeof(T);
-			int sizeU = sizeof(U);
-
-			if (sizeT <= sizeU)
-			{
-				for (int i = 0; i < height; ++i)
-				{
-					for (int j = 0; j < width; ++j)
-					{
-						unsigned char* pT = (unsigned char*)(pData[i] + j);
-						unsigned char* pU = (unsigned char*)&value;
-						for (int k = 0; k < sizeT; ++k)
-						{
-							pT[k] = pU[k];
-						}
-					}
-					//p[i] = (T&)value;
-				}
-			}
-			else
-			{
-				for (int i = 0; i < height; ++i)
-				{
-					for (int j = 0; j < width; ++j)
-					{
-						unsigned char* pT = (unsigned char*)(pData[i] + j);
-						unsigned char* pU = (unsigned char*)&value;
-						for (int k = 0; k < sizeU; ++k)
-						{
-							pT[k] = pU[k];
-						}
-					}
-
-					//p[i] = (T&)value;
-				}
-			}
-		}
-	}
-}
-
-template<typename T>
-template<typename U>
-void DynamicMatrix<T>::clear(int x, int y, int size_x, int size_y, const U& value)
-{
-	if (!pData || !pData[0]) return;
-
-	T* p = pData[0];
-	int lineWidth = getLineWidth();
-	int xend = x + size_x;
-	if (sizeof(U) == 1)
-	{
-		for (int i = 0; i < size_y; ++i)
-		{
-			unsigned char* pT = (unsigned char*)(pData[y + i] + x);
-			int size = xend < width ? size_x * sizeof(T) : lineWidth;
-			memset(pT, value, size);
-		}
-	}
-	else
-	{
-		unsigned val = (unsigned&)value & 0xFF;
-		if (val == (unsigned&)value)
-		{
-			//memset( p,val, lineWidth * height );
-			for (int i = 0; i < size_y; ++i)
-			{
-				unsigned char* pT = (unsigned char*)(pData[y + i] + x);
-				int size = xend < width ? size_x * sizeof(T) : lineWidth;
-				memset(pT, val, size);
-			}
-		}
-		else
-		{
-			int sizeT = sizeof(T);
-			int sizeU = sizeof(U);
-			unsigned char* pU = (unsigned char*)&value;
-			int leftBytes = xend < width ? 0 : lineWidth - xend * sizeof(T);
-
-			if (sizeT <= sizeU)
-			{
-
-				for (int i = 0; i < size_y; ++i)
-				{
-					for (int j = 0; j < size_x; ++j)
-					{
-						unsigned char* pT = (unsigned char*)(pData[y + i] + j);
-						for (int k = 0; k < sizeT; ++k)
-						{
-							pT[k] = pU[k];
-						}
-					}
-
-					unsigned char* pT = xend * sizeof(T);
-					for (int k = 0; k < leftBytes; ++k)
-					{
-						pT[k] = pU[k];
-					}
-				}
-			}
-			else
-			{
-				for (int i = 0; i < size_y; ++i)
-				{
-					for (int j = 0; j < size_x; ++j)
-					{
-						unsigned char* pT = (unsigned char*)(pData[y + i] + j);
-						for (int k = 0; k < sizeU; ++k)
-						{
-							pT[k] = pU[k];
-						}
-					}
-
-					unsigned char* pT = xend * sizeof(T);
-					for (int k = 0; k < leftBytes; ++k)
-					{
-						pT[k] = pU[k];
-					}
-
-				}
-			}
-		}
-	}
-}
-
-#pragma endregion DynamicMatrix
-
 LRESULT CALLBACK WndProcNew(HWND hWnd, UINT wMsg, WPARAM wParam, LPARAM lParam);
 void setWindowSize(int width, int height);
 WNDPROC g_lpfnOldProc = 0;
@@ -268,17 +42,30 @@ unsigned g_penColor = 0;
 bool g_isDragging = false;
 POINT g_lastPoint = { 0, 0 };
 
+DirtyRect g_dirtyRect;// 自上次显示以来被修改的区域
+
+///当前线程的裁剪矩形（设备坐标，包含端点），t_clipping为false时不裁剪
+thread_local bool t_clipping = false;
+thread_local int t_clipX0, t_clipY0, t_clipX1, t_clipY1;
+
 
 
 #ifndef DIRECT_DRAW
 
 HDC g_hdcMem = 0;
-typedef unsigned char rgb[3];
-DynamicMatrix<rgb> g_frameBuffer(4);
-DynamicMatrix<byte> g_frameBuffer_Alpha;
+///后台缓冲区，每个像素为一个32位BGRA值（内存中依次为b,g,r,a），内存即为g_hBitmap（DIB位图）的像素
+DynamicMatrix<unsigned> g_frameBuffer;
+DynamicMatrix<unsigned> g_offscreenTarget;// 重定向时引用调用者提供的离屏缓冲区
+DynamicMatrix<unsigned>* g_pRenderTarget = &g_frameBuffer;// 当前绘制目标
 DynamicMatrix<float> g_zBuffer;
 DynamicMatrix<unsigned> g_stencilBuffer;
 
+///写像素时是否更新已修改区域，设置了裁剪矩形或重定向了绘制目标时由调用者负责
+inline bool _tracksDirty()
+{
+	return !t_clipping && g_pRenderTarget == &g_frameBuffer;
+}
+
 BITMAPINFO g_bmpInfo;
 HBITMAP g_hBitmap;
 
@@ -334,7 +121,7 @@ int init(unsigned hwnd)
 		g_hdcMem = CreateCompatibleDC(g_hDC);
 		g_bmpInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
 		g_bmpInfo.bmiHeader.biPlanes = 1;
-		g_bmpInfo.bmiHeader.biBitCount = 24;
+		g_bmpInfo.bmiHeader.biBitCount = 32;
 		g_bmpInfo.bmiHeader.biCompression = BI_RGB;
 		g_bmpInfo.bmiHeader.biSizeImage = 0;
 		g_bmpInfo.bmiHeader.biXPelsPerMeter = 3000;
@@ -379,9 +166,16 @@ void _ensure_inited()
 
 void _initMemDC()
 {
-	g_hBitmap = CreateCompatibleBitmap(g_hDC, g_clientWidth, g_clientHeight);
+	g_bmpInfo.bmiHeader.biWidth = g_clientWidth;
+	g_bmpInfo.bmiHeader.biHeight = -g_clientHeight;//自上而下的DIB，首行为窗口顶行
+
+	//帧缓冲区直接使用DIB位图的内存，显示时无需再整体拷贝
+	void* pBits = 0;
+	g_hBitmap = CreateDIBSection(g_hDC, &g_bmpInfo, DIB_RGB_COLORS, &pBits, NULL, 0);
 	HBITMAP hOldBitmap = (HBITMAP)SelectObject(g_hdcMem, g_hBitmap);
 	DeleteObject(hOldBitmap);
+
+	g_frameBuffer.attach((unsigned*)pBits, g_clientWidth, g_clientHeight, 4);
 }
 
 #endif
@@ -451,72 +245,110 @@ void setWindowSize(int width, int height)
 
 #ifndef DIRECT_DRAW
 	_initMemDC();
-	g_frameBuffer.setSize(g_clientWidth, g_clientHeight);
-	g_frameBuffer_Alpha.setSize(g_clientWidth, g_clientHeight);
 	g_zBuffer.setSize( g_clientWidth, g_clientHeight);
 	g_stencilBuffer.setSize( g_clientWidth, g_clientHeight);
-
-	g_bmpInfo.bmiHeader.biWidth = g_clientWidth;
-	g_bmpInfo.bmiHeader.biHeight = -g_clientHeight;
 	//g_frameBuffer.clearWithValue(g_backColor);
+	g_dirtyRect.expand(0, 0, g_clientWidth - 1, g_clientHeight - 1);
 #endif
 }
 
+bool getDirtyRect(int& x, int& y, int& width, int& height)
+{
+	DirtyRect rect = g_dirtyRect;
+	rect.clip(g_clientWidth, g_clientHeight);
+	if (rect.isEmpty()) return false;
+
+	x = rect.x0;
+	y = rect.y0;
+	width = rect.x1 - rect.x0 + 1;
+	height = rect.y1 - rect.y0 + 1;
+	return true;
+}
+
+void addDirtyRect(int x, int y, int width, int height)
+{
 #ifndef DIRECT_DRAW
+	if (g_pRenderTarget != &g_frameBuffer) return;
+#endif
+
+	g_dirtyRect.expand(x, y, x + width - 1, y + height - 1);
+}
 
-void _buildMemDCFromFrameBuffer( )
+void resetDirtyRect()
 {
-	SetDIBits( g_hdcMem, g_hBitmap, 0, abs( g_bmpInfo.bmiHeader.biHeight), g_frameBuffer.dataPtr(), &g_bmpInfo, DIB_RGB_COLORS); 
+	g_dirtyRect.reset();
+}
 
-	//for (int row = 0; row < g_frameBuffer.height; ++row)
-	//{
-	//	for (int col = 0; col < g_frameBuffer.width; ++col)
-	//	{
-	//		unsigned color = g_frameBuffer[row][col];
-	//		if (color != g_backColor)
-	//			::SetPixel(g_hdcMem, col, row, color);
-	//	}
-	//}
+void setClipRect(int x, int y, int width, int height)
+{
+	t_clipping = true;
+	t_clipX0 = x;
+	t_clipY0 = y;
+	t_clipX1 = x + width - 1;
+	t_clipY1 = y + height - 1;
 }
 
+void resetClipRect()
+{
+	t_clipping = false;
+}
 
-void _clearMemDC()
+bool getClipRect(int& x, int& y, int& width, int& height)
 {
-	static HBRUSH hBrush = CreateSolidBrush( g_backColor );
-	RECT rect;
-	GetClientRect( g_hWnd, &rect);
-	::FillRect(g_hdcMem, &rect , hBrush);
+	if (!t_clipping) return false;
+
+	x = t_clipX0;
+	y = t_clipY0;
+	width = t_clipX1 - t_clipX0 + 1;
+	height = t_clipY1 - t_clipY0 + 1;
+	return true;
+}
+
+void setRenderTarget(unsigned* pBits, int width, int height, int pitch)
+{
+#ifndef DIRECT_DRAW
+	if (pBits == NULL || width <= 0 || height <= 0)
+	{
+		g_pRenderTarget = &g_frameBuffer;
+		return;
+	}
+
+	// 按pitch对齐时行宽正好为pitch个像素
+	g_offscreenTarget.attach(pBits, width, height, pitch * sizeof(unsigned));
+	g_pRenderTarget = &g_offscreenTarget;
+#endif
 }
 
-/**	将后台缓冲区信息显示到屏幕
+/**	将后台缓冲区中已修改的区域显示到屏幕
 */
 void swapBuffer()
 {
 	_ensure_inited();
 
-	_buildMemDCFromFrameBuffer();
+#ifndef DIRECT_DRAW
+	//帧缓冲区即DIB位图，只需把已修改区域拷贝到屏幕，显示设备需要24位等其他格式时由GDI在此转换
+	int x, y, width, height;
+	if (getDirtyRect(x, y, width, height))
+	{
+		BitBlt(g_hDC, x, y, width, height, g_hdcMem, x, y, SRCCOPY);
+	}
 
-	RECT rect;
-	GetClientRect(g_hWnd, &rect);
+	//之后会直接写DIB内存，需先完成GDI对位图的所有操作
+	GdiFlush();
+#endif
 
-	BitBlt(g_hDC, 0, 0, g_clientWidth, g_clientHeight /*g_frameBuffer.width, g_frameBuffer.height*/, g_hdcMem, 0, 0, SRCCOPY);
+	resetDirtyRect();
 }
 
-
-#endif
-
 void refreshWindow()
 {
 	InvalidateRect(g_hWnd, NULL, TRUE);
 }
 
-unsigned RGBtoBGR( unsigned color )
+///Color(0xAABBGGRR)与帧缓冲区BGRA像素(0xAARRGGBB)互相转换，交换r和b分量
+inline unsigned RGBtoBGR(unsigned color)
 {
-	unsigned char* pColor = (unsigned char*)&color;
-	unsigned char c = pColor[0] ;
-	pColor[0] = pColor[2];
-	pColor[2] = c;
-	return color;
+	return _BGRA(color);
 }
 
 void clearWindow()
@@ -524,12 +356,18 @@ void clearWindow()
 	_ensure_inited();	
 
 #ifndef DIRECT_DRAW
+	if (t_clipping)
+	{
+		//只清除裁剪矩形内的部分，已修改区域由设置裁剪矩形的调用者提交
+		int width = t_clipX1 - t_clipX0 + 1, height = t_clipY1 - t_clipY0 + 1;
+		g_frameBuffer.clear(t_clipX0, t_clipY0, width, height, RGBtoBGR(g_backColor));
+		g_zBuffer.clear(t_clipX0, t_clipY0, width, height, (float)1.0);
+		return;
+	}
+
 	g_frameBuffer.clear( RGBtoBGR( g_backColor));
-	g_frameBuffer_Alpha.clear(((char*)&g_backColor)[3]);
 	g_zBuffer.clear( (float)1.0 );
-	//_buildMemDCFromFrameBuffer();
-
-	_clearMemDC();
+	addDirtyRect(0, 0, g_clientWidth, g_clientHeight);
 #else
 	static HBRUSH hBrush = CreateSolidBrush( g_backColor );
 	RECT rect;
@@ -720,17 +558,14 @@ void _setPixel(int x, int y, Color color)
 	//_ensure_inited();
 
 #ifndef DIRECT_DRAW
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
 
-	if (x < 0 || x >= g_frameBuffer.width) return;
-	if (y < 0 || y >= g_frameBuffer.height) return;
+	if (x < 0 || x >= target.width) return;
+	if (y < 0 || y >= target.height) return;
+	if (t_clipping && (x < t_clipX0 || x > t_clipX1 || y < t_clipY0 || y > t_clipY1)) return;
 
-	char* pBytes = (char*)( g_frameBuffer[y] + x);
-	char* pColor = (char*)&color;
-	pBytes[0] = pColor[2];
-	pBytes[1] = pColor[1];
-	pBytes[2] = pColor[0];
-	g_frameBuffer_Alpha[y][x] = pColor[3];
-	//g_frameBuffer[y][x] = color;
+	target[y][x] = RGBtoBGR(color);
+	if (_tracksDirty()) g_dirtyRect.expand(x, y);
 #else
 	//SetPixel( g_hdcMem, x, y, color );
 	SetPixel(g_hDC, x, y, color);
@@ -740,18 +575,16 @@ void _setPixel(int x, int y, Color color)
 void _setPixel(int x, int y, float z, Color color)
 {
 #ifndef DIRECT_DRAW
-	if (x < 0 || x >= g_frameBuffer.width) return;
-	if (y < 0 || y >= g_frameBuffer.height) return;
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (x < 0 || x >= target.width) return;
+	if (y < 0 || y >= target.height) return;
+	if (t_clipping && (x < t_clipX0 || x > t_clipX1 || y < t_clipY0 || y > t_clipY1)) return;
+	if (x >= g_zBuffer.width || y >= g_zBuffer.height) return;
 	if( z < 0 || z > 1.0 || z >= g_zBuffer[y][x]) return ;
 
-	char* pBytes = (char*)( g_frameBuffer[y] + x);
-	char* pColor = (char*)&color;
-	pBytes[0] = pColor[2];
-	pBytes[1] = pColor[1];
-	pBytes[2] = pColor[0];
+	target[y][x] = RGBtoBGR(color);
 	g_zBuffer[y][x] = z;
-	g_frameBuffer_Alpha[y][x] = pColor[3];
-	//g_frameBuffer[y][x] = color;
+	if (_tracksDirty()) g_dirtyRect.expand(x, y);
 #else
 	//SetPixel( g_hdcMem, x, y, color );
 	SetPixel(g_hDC, x, y, color);
@@ -804,22 +637,72 @@ void setDevicePixel(int x, int y, float z, Color color)
 	_setPixel( x, y, z, color );
 }
 
+unsigned* getFrameBuffer(int& width, int& height, int& pitch)
+{
+#ifndef DIRECT_DRAW
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	width = target.width;
+	height = target.height;
+	pitch = target.getLineWidth() / sizeof(unsigned);
+	return target.dataPtr();
+#else
+	width = height = pitch = 0;
+	return NULL;
+#endif
+}
+
+void fillDeviceSpan(int y, int x0, int x1, Color color)
+{
+	if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+
+#ifndef DIRECT_DRAW
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (y < 0 || y >= target.height) return;
+	if (x0 < 0) x0 = 0;
+	if (x1 >= target.width) x1 = target.width - 1;
+	if (t_clipping)
+	{
+		if (y < t_clipY0 || y > t_clipY1) return;
+		if (x0 < t_clipX0) x0 = t_clipX0;
+		if (x1 > t_clipX1) x1 = t_clipX1;
+	}
+	if (x0 > x1) return;
+
+	_fillDWords(target[y] + x0, x1 - x0 + 1, RGBtoBGR(color), false);
+	if (_tracksDirty()) g_dirtyRect.expand(x0, y, x1, y);
+#else
+	for (int x = x0; x <= x1; ++x)
+	{
+		setDevicePixel(x, y, color);
+	}
+#endif
+}
+
+void fillSpan(int y, int x0, int x1, Color color)
+{
+#ifndef DIRECT_DRAW
+	int dy;
+	LPtToDPt( x0, y, x0, dy );
+	LPtToDPt( x1, y, x1, dy );
+	fillDeviceSpan( dy, x0, x1, color );
+#else
+	if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+	for (int x = x0; x <= x1; ++x)
+	{
+		_setPixel( x, y, color );
+	}
+#endif
+}
+
 Color getDevicePixel(int x, int y)
 {
 #ifndef DIRECT_DRAW
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+
+	if (x < 0 || x >= target.width) return 0;
+	if (y < 0 || y >= target.height) return 0;
 
-	if (x < 0 || x >= g_frameBuffer.width) return 0;
-	if (y < 0 || y >= g_frameBuffer.height) return 0;
-
-	char* pBytes = (char*)( g_frameBuffer[y] + x);
-	unsigned color = 0;
-	char* pColor = (char*)&color;
-	pColor[0] = pBytes[2];
-	pColor[1] = pBytes[1];
-	pColor[2] = pBytes[0];
-	pColor[3] = g_frameBuffer_Alpha[y][x];
-	return color;
-	//return g_frameBuffer[y][x];
+	return RGBtoBGR(target[y][x]);
 #else
 	//return GetPixel( g_hdcMem, x, y );
 	return GetPixel(g_hDC, x, y);
@@ -836,6 +719,17 @@ Color getPixel(int x, int y)
 	return getDevicePixel( x,  y);
 }
 
+void readPixels(int x, int y, int width, int height, Color* pixels)
+{
+	for (int i = 0; i < height; ++i)
+	{
+		for (int j = 0; j < width; ++j)
+		{
+			pixels[i * width + j] = getDevicePixel(x + j, y + i);
+		}
+	}
+}
+
 void DPtToLPt(int dx, int dy, int& lx, int& ly)
 {
 #ifndef DIRECT_DRAW
@@ -1260,14 +1154,27 @@ LRESULT CALLBACK WndProcNew(HWND hWnd, UINT wMsg, WPARAM wParam, LPARAM lParam)
 	case WM_PAINT:
 		if (g_rubberPad.startDrawing) return 0;
 
-		clearWindow();
+		{
+			//只清除并重绘需要更新的区域：绘制期间设置为裁剪矩形，之后只显示该区域
+			//窗口被遮挡后重新显示的区域即使帧缓冲区未修改也需要重新显示
+			RECT rcUpdate;
+			bool partial = GetUpdateRect(g_hWnd, &rcUpdate, FALSE) != FALSE;
+			int width = rcUpdate.right - rcUpdate.left, height = rcUpdate.bottom - rcUpdate.top;
+			if (partial) setClipRect(rcUpdate.left, rcUpdate.top, width, height);
 
-		CallWindowProc(g_lpfnOldProc, hWnd, wMsg, wParam, lParam);
-		ValidateRect( g_hWnd, NULL );
+			clearWindow();
+
+			CallWindowProc(g_lpfnOldProc, hWnd, wMsg, wParam, lParam);
+			ValidateRect( g_hWnd, NULL );
+
+			if (partial)
+			{
+				resetClipRect();
+				addDirtyRect(rcUpdate.left, rcUpdate.top, width, height);
+			}
+		}
 
-#ifndef DIRECT_DRAW			
 		swapBuffer();
-#endif
 		return 0;
 	case WM_LBUTTONDOWN:
 		CallWindowProc(g_lpfnOldProc, hWnd, wMsg, wParam, lParam);
@@ -1294,3 +1201,4 @@ LRESULT CALLBACK WndProcNew(HWND hWnd, UINT wMsg, WPARAM wParam, LPARAM lParam)
 	return CallWindowProc(g_lpfnOldProc, hWnd, wMsg, wParam, lParam);
 }
 
+#endif // HEADLESS
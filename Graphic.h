@@ -17,6 +17,9 @@ version:    1.0
 
 //#define  DIRECT_DRAW
 
+///无窗口模式：图形接口绘制到内存帧缓冲区，不依赖Win32窗口和消息循环（也可通过编译选项 -DHEADLESS 指定）
+//#define  HEADLESS
+
 typedef unsigned Color;
 typedef unsigned char Byte;
 typedef unsigned short Word;
@@ -36,6 +39,9 @@ typedef unsigned int DWord;
 #define  _B( color ) ((Byte)(color >> 16))
 #define  _A( color ) ((Byte)(color >> 24))
 
+///颜色与帧缓冲区32位BGRA像素值相互转换（交换r和b分量）
+#define _BGRA( color ) (((unsigned)(color) & 0xFF00FF00) | (((unsigned)(color) >> 16) & 0xFF) | (((unsigned)(color) & 0xFF) << 16))
+
 #pragma endregion 
 
 ///像素点
@@ -44,6 +50,9 @@ struct PixelPoint
 	int x,y;
 };
 
+///多边形填充规则：奇偶规则下被奇数层边界包围的区域为内部，非零规则下边界环绕数不为0的区域为内部
+enum FillRule { frEvenOdd, frNonZero };
+
 /**	初始化
 @return 是否初始化成功，0-success， -1 - fail
 */
@@ -69,6 +78,12 @@ int getWindowHeight();
 */
 double getPixelSize();
 
+/**	设置窗口大小，无窗口模式下即帧缓冲区大小
+@param  width 窗口宽度，-1表示使用当前客户区宽度
+@param  height 窗口高度，-1表示使用当前客户区高度
+*/
+void setWindowSize(int width, int height);
+
 #pragma endregion 
 
 #pragma region keyboard
@@ -110,6 +125,71 @@ void drawPolygon( PixelPoint* pts, int count );
 */
 void refreshWindow();
 
+/**	使用背景色清空窗口（帧缓冲区），当前线程设置了裁剪矩形时只清除矩形内的部分
+*/
+void clearWindow();
+
+/**	读取设备坐标矩形区域内的像素颜色，按行从上到下存放
+@param  x 区域左上角设备x坐标
+@param  y 区域左上角设备y坐标
+@param  width 区域宽度
+@param  height 区域高度
+@param  pixels 输出像素数组，大小不小于width * height
+*/
+void readPixels(int x, int y, int width, int height, Color* pixels);
+
+/**	将后台缓冲区中已修改的区域显示到屏幕，并清空已修改区域；无窗口模式下只清空已修改区域
+*/
+void swapBuffer();
+
+/**	获取自上次swapBuffer或resetDirtyRect以来被修改过的设备坐标区域
+@param  x 区域左上角设备x坐标
+@param  y 区域左上角设备y坐标
+@param  width 区域宽度
+@param  height 区域高度
+@return 是否有被修改的区域
+*/
+bool getDirtyRect(int& x, int& y, int& width, int& height);
+
+/**	将设备坐标矩形区域标记为已修改，供通过getFrameBuffer直接写像素的模块使用
+@param  x 区域左上角设备x坐标
+@param  y 区域左上角设备y坐标
+@param  width 区域宽度
+@param  height 区域高度
+*/
+void addDirtyRect(int x, int y, int width, int height);
+
+/**	清空已修改区域
+*/
+void resetDirtyRect();
+
+/**	设置当前线程的设备坐标裁剪矩形，之后该线程通过setPixel、fillSpan、FrameBufferSink等写入的像素只保留矩形内的部分
+	设置裁剪矩形期间写像素不更新已修改区域，由调用者绘制完成后用addDirtyRect提交，多个线程可以同时绘制互不重叠的区域
+@param  x 矩形左上角设备x坐标
+@param  y 矩形左上角设备y坐标
+@param  width 矩形宽度
+@param  height 矩形高度
+*/
+void setClipRect(int x, int y, int width, int height);
+
+/**	取消当前线程的裁剪矩形
+*/
+void resetClipRect();
+
+/**	把之后所有线程的绘制重定向到调用者提供的离屏缓冲区，像素格式与getFrameBuffer相同，getFrameBuffer也返回该缓冲区
+	重定向期间写像素和addDirtyRect都不更新已修改区域；DIRECT_DRAW模式下不支持
+@param  pBits 离屏缓冲区首地址，为NULL时恢复绘制到帧缓冲区
+@param  width 离屏缓冲区宽度
+@param  height 离屏缓冲区高度
+@param  pitch 相邻两行首像素之间相隔的像素数，不小于width
+*/
+void setRenderTarget(unsigned* pBits, int width, int height, int pitch);
+
+/**	获取当前线程的裁剪矩形
+@return 是否设置了裁剪矩形
+*/
+bool getClipRect(int& x, int& y, int& width, int& height);
+
 /**	设置指定逻辑位置像素的颜色
 @param  x 逻辑x坐标
 @param  y  逻辑y坐标
@@ -138,6 +218,30 @@ void setDevicePixel(int x, int y, Color color);
 */
 void setDevicePixel(int x, int y, float z, Color color);
 
+/**	用指定颜色填充逻辑坐标系中一行连续的像素（包含两个端点），只做一次裁剪，整行批量写入
+@param  y 逻辑y坐标
+@param  x0 起点逻辑x坐标
+@param  x1 终点逻辑x坐标
+@param color 颜色
+*/
+void fillSpan(int y, int x0, int x1, Color color);
+
+/**	用指定颜色填充设备坐标系中一行连续的像素（包含两个端点），设备坐标系原点位于左上角（x向右，y向下）
+@param  y 设备y坐标
+@param  x0 起点设备x坐标
+@param  x1 终点设备x坐标
+@param color 颜色
+*/
+void fillDeviceSpan(int y, int x0, int x1, Color color);
+
+/**	获取当前绘制目标（默认为后台帧缓冲区，见setRenderTarget），供需要直接写像素的模块使用，像素为32位BGRA值（见_BGRA），按行从上到下存放
+@param  width 帧缓冲区宽度
+@param  height 帧缓冲区高度
+@param  pitch 相邻两行首像素之间相隔的像素数
+@return 帧缓冲区首地址，DIRECT_DRAW模式下没有帧缓冲区，返回NULL
+*/
+unsigned* getFrameBuffer(int& width, int& height, int& pitch);
+
 /**	获取指定位置像素的颜色
 @param  x 逻辑x坐标
 @param  y  逻辑y坐标
@@ -0,0 +1,506 @@
+/********************************************************************
+file base:	GraphicHeadless
+file ext:	cpp
+author:		作者(njnu2016@foxmail.com)
+purpose:	图形库无窗口实现，绘制到内存帧缓冲区，不依赖Win32
+version:    1.0
+*********************************************************************/
+#include "Graphic.h"
+
+#ifdef HEADLESS
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "DynamicMatrix.h"
+#include "DirtyRect.h"
+
+using namespace std;
+
+int g_clientWidth = 800;
+int g_clientHeight = 600;
+
+PixelPoint g_orig = { 0, 0 };
+int g_upY = 1;
+
+bool g_inited = false;
+
+unsigned g_backColor = WHITE;
+int g_fontSize = 28;
+char g_fontName[32] = "宋体";
+
+unsigned g_penColor = 0;
+
+///帧缓冲区，像素格式与Win32实现相同，为32位BGRA
+DynamicMatrix<unsigned> g_frameBuffer;
+DynamicMatrix<unsigned> g_offscreenTarget;// 重定向时引用调用者提供的离屏缓冲区
+DynamicMatrix<unsigned>* g_pRenderTarget = &g_frameBuffer;// 当前绘制目标
+DynamicMatrix<float> g_zBuffer;
+DynamicMatrix<unsigned> g_stencilBuffer;
+
+DirtyRect g_dirtyRect;// 自上次swapBuffer以来被修改的区域
+
+///当前线程的裁剪矩形（设备坐标，包含端点），t_clipping为false时不裁剪
+thread_local bool t_clipping = false;
+thread_local int t_clipX0, t_clipY0, t_clipX1, t_clipY1;
+
+///写像素时是否更新已修改区域，设置了裁剪矩形或重定向了绘制目标时由调用者负责
+inline bool _tracksDirty()
+{
+	return !t_clipping && g_pRenderTarget == &g_frameBuffer;
+}
+
+RubberMode g_rubberMode = rmNone;
+
+int init(unsigned /*hwnd*/)
+{
+	g_inited = true;
+
+	setWindowSize(g_clientWidth, g_clientHeight);
+
+	setYUp(g_upY == -1 ? true : false);
+	setOrig(g_orig.x, g_orig.y);
+
+	return 0;
+}
+
+int init()
+{
+	return init(0);
+}
+
+void _ensure_inited()
+{
+	if (!g_inited) init();
+}
+
+void setWindowSize(int width, int height)
+{
+	if (!g_inited)
+	{
+		if (width > 0) g_clientWidth = width;
+		if (height > 0) g_clientHeight = height;
+		init();
+		return;
+	}
+
+	if (width > 0) g_clientWidth = width;
+	if (height > 0) g_clientHeight = height;
+
+	g_frameBuffer.setSize(g_clientWidth, g_clientHeight);
+	g_zBuffer.setSize(g_clientWidth, g_clientHeight);
+	g_stencilBuffer.setSize(g_clientWidth, g_clientHeight);
+	g_dirtyRect.expand(0, 0, g_clientWidth - 1, g_clientHeight - 1);
+}
+
+bool getDirtyRect(int& x, int& y, int& width, int& height)
+{
+	DirtyRect rect = g_dirtyRect;
+	rect.clip(g_clientWidth, g_clientHeight);
+	if (rect.isEmpty()) return false;
+
+	x = rect.x0;
+	y = rect.y0;
+	width = rect.x1 - rect.x0 + 1;
+	height = rect.y1 - rect.y0 + 1;
+	return true;
+}
+
+void addDirtyRect(int x, int y, int width, int height)
+{
+	if (g_pRenderTarget != &g_frameBuffer) return;
+
+	g_dirtyRect.expand(x, y, x + width - 1, y + height - 1);
+}
+
+void resetDirtyRect()
+{
+	g_dirtyRect.reset();
+}
+
+void setClipRect(int x, int y, int width, int height)
+{
+	t_clipping = true;
+	t_clipX0 = x;
+	t_clipY0 = y;
+	t_clipX1 = x + width - 1;
+	t_clipY1 = y + height - 1;
+}
+
+void resetClipRect()
+{
+	t_clipping = false;
+}
+
+bool getClipRect(int& x, int& y, int& width, int& height)
+{
+	if (!t_clipping) return false;
+
+	x = t_clipX0;
+	y = t_clipY0;
+	width = t_clipX1 - t_clipX0 + 1;
+	height = t_clipY1 - t_clipY0 + 1;
+	return true;
+}
+
+void setRenderTarget(unsigned* pBits, int width, int height, int pitch)
+{
+	if (pBits == NULL || width <= 0 || height <= 0)
+	{
+		g_pRenderTarget = &g_frameBuffer;
+		return;
+	}
+
+	// 按pitch对齐时行宽正好为pitch个像素
+	g_offscreenTarget.attach(pBits, width, height, pitch * sizeof(unsigned));
+	g_pRenderTarget = &g_offscreenTarget;
+}
+
+/**	无窗口模式下没有需要显示的屏幕，帧缓冲区即为最终结果，调用者可在此之前用getDirtyRect和readPixels取出变化的区域
+*/
+void swapBuffer()
+{
+	resetDirtyRect();
+}
+
+/**	无窗口模式下没有消息循环，由调用者自行clearWindow并重绘
+*/
+void refreshWindow()
+{
+}
+
+inline unsigned RGBtoBGR(unsigned color)
+{
+	return _BGRA(color);
+}
+
+void clearWindow()
+{
+	_ensure_inited();
+
+	if (t_clipping)
+	{
+		//只清除裁剪矩形内的部分，已修改区域由设置裁剪矩形的调用者提交
+		int width = t_clipX1 - t_clipX0 + 1, height = t_clipY1 - t_clipY0 + 1;
+		g_frameBuffer.clear(t_clipX0, t_clipY0, width, height, RGBtoBGR(g_backColor));
+		g_zBuffer.clear(t_clipX0, t_clipY0, width, height, (float)1.0);
+		return;
+	}
+
+	g_frameBuffer.clear(RGBtoBGR(g_backColor));
+	g_zBuffer.clear((float)1.0);
+	addDirtyRect(0, 0, g_clientWidth, g_clientHeight);
+}
+
+void setOrig(int x, int y)
+{
+	_ensure_inited();
+
+	g_orig.x = x;
+	g_orig.y = y;
+}
+
+void getOrig(int& x, int& y)
+{
+	_ensure_inited();
+
+	x = g_orig.x;
+	y = g_orig.y;
+}
+
+void setYUp(bool isUp)
+{
+	g_upY = isUp ? -1 : 1;
+}
+
+bool isYUp()
+{
+	return g_upY == -1;
+}
+
+void setBackColor(Color color)
+{
+	g_backColor = color;
+}
+
+Color getBackColor()
+{
+	return g_backColor;
+}
+
+Color getPenColor()
+{
+	return g_penColor;
+}
+
+void setPenColor(Color color)
+{
+	g_penColor = color;
+}
+
+double getPixelSize()
+{
+	return 25.4 / 96;
+}
+
+int getFontSize()
+{
+	return g_fontSize;
+}
+
+void setFontSize(int fontSize)
+{
+	g_fontSize = fontSize;
+}
+
+int fontSizeToFontHeight(int fontSize)
+{
+	return fontSize * 96 / 72;
+}
+
+int fontHeightToFontSize(int fontHeight)
+{
+	return abs(fontHeight) * 72 / 96;
+}
+
+const char* getFontName()
+{
+	return g_fontName;
+}
+
+void setFontName(const char* fontName)
+{
+	strncpy(g_fontName, fontName, sizeof(g_fontName) - 1);
+	g_fontName[sizeof(g_fontName) - 1] = 0;
+}
+
+void drawLine(int /*x0*/, int /*y0*/, int /*x1*/, int /*y1*/)
+{
+}
+
+void drawPolygon(PixelPoint* /*pts*/, int /*count*/)
+{
+}
+
+void _setPixel(int x, int y, Color color)
+{
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (x < 0 || x >= target.width) return;
+	if (y < 0 || y >= target.height) return;
+	if (t_clipping && (x < t_clipX0 || x > t_clipX1 || y < t_clipY0 || y > t_clipY1)) return;
+
+	target[y][x] = RGBtoBGR(color);
+	if (_tracksDirty()) g_dirtyRect.expand(x, y);
+}
+
+void _setPixel(int x, int y, float z, Color color)
+{
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (x < 0 || x >= target.width) return;
+	if (y < 0 || y >= target.height) return;
+	if (t_clipping && (x < t_clipX0 || x > t_clipX1 || y < t_clipY0 || y > t_clipY1)) return;
+	if (x >= g_zBuffer.width || y >= g_zBuffer.height) return;
+	if (z < 0 || z > 1.0 || z >= g_zBuffer[y][x]) return;
+
+	target[y][x] = RGBtoBGR(color);
+	g_zBuffer[y][x] = z;
+	if (_tracksDirty()) g_dirtyRect.expand(x, y);
+}
+
+void setPixel(int x, int y, Color color)
+{
+	LPtToDPt(x, y, x, y);
+	_setPixel(x, y, color);
+}
+
+void setPixel(int x, int y, float z, Color color)
+{
+	LPtToDPt(x, y, x, y);
+	_setPixel(x, y, z, color);
+}
+
+void setDevicePixel(int x, int y, Color color)
+{
+	_setPixel(x, y, color);
+}
+
+void setDevicePixel(int x, int y, float z, Color color)
+{
+	_setPixel(x, y, z, color);
+}
+
+unsigned* getFrameBuffer(int& width, int& height, int& pitch)
+{
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	width = target.width;
+	height = target.height;
+	pitch = target.getLineWidth() / sizeof(unsigned);
+	return target.dataPtr();
+}
+
+void fillDeviceSpan(int y, int x0, int x1, Color color)
+{
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+
+	if (y < 0 || y >= target.height) return;
+	if (x0 < 0) x0 = 0;
+	if (x1 >= target.width) x1 = target.width - 1;
+	if (t_clipping)
+	{
+		if (y < t_clipY0 || y > t_clipY1) return;
+		if (x0 < t_clipX0) x0 = t_clipX0;
+		if (x1 > t_clipX1) x1 = t_clipX1;
+	}
+	if (x0 > x1) return;
+
+	_fillDWords(target[y] + x0, x1 - x0 + 1, RGBtoBGR(color), false);
+	if (_tracksDirty()) g_dirtyRect.expand(x0, y, x1, y);
+}
+
+void fillSpan(int y, int x0, int x1, Color color)
+{
+	int dy;
+	LPtToDPt(x0, y, x0, dy);
+	LPtToDPt(x1, y, x1, dy);
+	fillDeviceSpan(dy, x0, x1, color);
+}
+
+Color getDevicePixel(int x, int y)
+{
+	DynamicMatrix<unsigned>& target = *g_pRenderTarget;
+	if (x < 0 || x >= target.width) return 0;
+	if (y < 0 || y >= target.height) return 0;
+
+	return RGBtoBGR(target[y][x]);
+}
+
+Color getPixel(int x, int y)
+{
+	LPtToDPt(x, y, x, y);
+	return getDevicePixel(x, y);
+}
+
+void readPixels(int x, int y, int width, int height, Color* pixels)
+{
+	for (int i = 0; i < height; ++i)
+	{
+		for (int j = 0; j < width; ++j)
+		{
+			pixels[i * width + j] = getDevicePixel(x + j, y + i);
+		}
+	}
+}
+
+void DPtToLPt(int dx, int dy, int& lx, int& ly)
+{
+	lx = dx - g_orig.x;
+	ly = (dy - g_orig.y) * g_upY;
+}
+
+void LPtToDPt(int lx, int ly, int& dx, int& dy)
+{
+	dx = lx + g_orig.x;
+	dy = g_orig.y + g_upY * ly;
+}
+
+int getWindowWidth()
+{
+	return g_clientWidth;
+}
+
+int getWindowHeight()
+{
+	return g_clientHeight;
+}
+
+bool isShiftKeyPressed()
+{
+	return false;
+}
+
+bool isCtrlKeyPressed()
+{
+	return false;
+}
+
+bool isAltKeyPressed()
+{
+	return false;
+}
+
+#pragma region rubberLine
+
+///无窗口模式下没有鼠标输入，橡皮筋只保存模式，点集合始终为空
+
+void setCursor(CursorStyle /*cursor*/)
+{
+}
+
+void setRubberMode(RubberMode mode)
+{
+	g_rubberMode = mode;
+}
+
+RubberMode getRubberMode()
+{
+	return g_rubberMode;
+}
+
+int getRubberPointCount()
+{
+	return 0;
+}
+
+int getRubberPoints(int& /*x1*/, int& /*y1*/, int& /*x2*/, int& /*y2*/)
+{
+	return 0;
+}
+
+int getRubberPoints(PixelPoint& pt1, PixelPoint& pt2)
+{
+	return getRubberPoints(pt1.x, pt1.y, pt2.x, pt2.y);
+}
+
+int getRubberPoints(PixelPoint /*pts*/[])
+{
+	return 0;
+}
+
+#pragma endregion
+
+#pragma region font
+
+///无窗口模式下没有GDI字体，字符位图为空
+
+Byte* getWCharGlyph(wchar_t /*ch*/, int& offset_x, int& offset_y, int& gryph_width, int& gryph_height, int& cell_width, int& cell_height)
+{
+	offset_x = offset_y = 0;
+	gryph_width = gryph_height = 0;
+	cell_width = cell_height = 0;
+	return 0;
+}
+
+Byte* getCharGlyph(char ch, int& offset_x, int& offset_y, int& gryph_width, int& gryph_height, int& cell_width, int& cell_height)
+{
+	return getWCharGlyph((wchar_t)(unsigned char)ch, offset_x, offset_y, gryph_width, gryph_height, cell_width, cell_height);
+}
+
+Byte getCharGlyphPixel(Byte* pCharGlyph, int x, int y, int offset_x, int offset_y, int gryph_width, int gryph_height)
+{
+	if (pCharGlyph == NULL) return 0;
+	if (x < offset_x || y < offset_y || x >= offset_x + gryph_width || y >= offset_y + gryph_height) return 0;
+
+	int gryph_width_byte = gryph_width >> 3;//每行字节数
+	pCharGlyph += (y - offset_y) * gryph_width_byte;//定位到行
+	x -= offset_x;
+	pCharGlyph += x >> 3;//定位到字节
+	Byte btCode = *pCharGlyph;
+	x -= (x >> 3) << 3;//定位到bit
+	return (btCode & (0x80 >> x)) ? 1 : 0;
+}
+
+#pragma endregion
+
+#endif // HEADLESS
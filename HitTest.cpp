@@ -0,0 +1,244 @@
+#include "HitTest.h"
+#include "GeoDefine.h"
+#include "Renderer.h"
+#include <math.h>
+#include <algorithm>
+
+/// 绘制时是否填充（见emitGeometry），否则只画线或轮廓
+static bool isFilled(const GeometryRecord& record)
+{
+	switch (record.operationType)
+	{
+	case otFillPolygon:
+	case otFillRectangle:
+		return record.type == gtPolygon;
+	case otFillCircle:
+		return record.type == gtCircle;
+	case otFillEllipse:
+		return record.type == gtEllipse;
+	default:
+		return false;
+	}
+}
+
+/// 圆绘制时的圆心和半径（世界坐标），与emitGeometry一样按视图变换到像素后取整，坐标为圆心和(r, r)
+/// 超出保护带的圆按原来的坐标折线化后绘制，不取整
+static void getCircle(const GeometryRecord& record, double& cx, double& cy, double& r)
+{
+	const ViewTransform& view = g_viewTransform;
+	double lx, ly, lr = record.pts[1].x * view.getScale();
+	view.worldToLogical(record.pts[0].x, record.pts[0].y, lx, ly);
+	if (!ViewTransform::inGuardBand(lx - lr, ly - lr) || !ViewTransform::inGuardBand(lx + lr, ly + lr))
+	{
+		cx = record.pts[0].x, cy = record.pts[0].y, r = record.pts[1].x;
+		return;
+	}
+	PixelPoint center = view.toPixel(record.pts[0].x, record.pts[0].y);
+	view.logicalToWorld(center.x, center.y, cx, cy);
+	r = view.toWorldLength(view.toPixelLength(record.pts[1].x));
+}
+
+/// 椭圆绘制时的圆心和半径（世界坐标），与emitGeometry一样按视图变换到像素后取整，坐标为两个对角点
+/// 超出保护带的椭圆按原来的坐标折线化后绘制，不取整
+static void getEllipse(const GeometryRecord& record, double& cx, double& cy, double& rx, double& ry)
+{
+	const ViewTransform& view = g_viewTransform;
+	double lx0, ly0, lx1, ly1;
+	view.worldToLogical(record.pts[0].x, record.pts[0].y, lx0, ly0);
+	view.worldToLogical(record.pts[1].x, record.pts[1].y, lx1, ly1);
+	if (!ViewTransform::inGuardBand(lx0, ly0) || !ViewTransform::inGuardBand(lx1, ly1))
+	{
+		cx = (record.pts[0].x + record.pts[1].x) * 0.5, cy = (record.pts[0].y + record.pts[1].y) * 0.5;
+		rx = fabs(record.pts[1].x - record.pts[0].x) * 0.5, ry = fabs(record.pts[1].y - record.pts[0].y) * 0.5;
+		return;
+	}
+	PixelPoint p0 = view.toPixel(record.pts[0].x, record.pts[0].y);
+	PixelPoint p1 = view.toPixel(record.pts[1].x, record.pts[1].y);
+	view.logicalToWorld((int)((p0.x + p1.x) * 0.5), (int)((p0.y + p1.y) * 0.5), cx, cy);
+	rx = view.toWorldLength(abs(p1.x - p0.x) / 2);
+	ry = view.toWorldLength(abs(p1.y - p0.y) / 2);
+}
+
+/// 依次对几何对象绘制出的每条线段调用visit(x0, y0, x1, y1)，visit返回true时停止并返回true
+/// 水平线、垂直线只画首尾两点之间的一条线段，多边形的各环首尾相连
+template<class Visit>
+static bool forEachSegment(const GeometryRecord& record, Visit visit)
+{
+	const Point2D* pts = record.pts;
+	int count = record.count;
+	if (record.type == gtPolygon)
+	{
+		for (int r = 0; r < record.ringCount; ++r)
+		{
+			int first = record.ringOffsets[r], last = record.ringOffsets[r + 1] - 1;
+			for (int i = first; i <= last; ++i)
+			{
+				const Point2D& a = pts[i];
+				const Point2D& b = pts[i < last ? i + 1 : first];
+				if (visit(a.x, a.y, b.x, b.y)) return true;
+			}
+		}
+		return false;
+	}
+
+	if (count < 2) return false;
+	if (record.operationType == otDrawHoriLine) return visit(pts[0].x, pts[0].y, pts[count - 1].x, pts[0].y);
+	if (record.operationType == otDrawVertLine) return visit(pts[0].x, pts[0].y, pts[0].x, pts[count - 1].y);
+	for (int i = 0; i + 1 < count; ++i)
+	{
+		if (visit(pts[i].x, pts[i].y, pts[i + 1].x, pts[i + 1].y)) return true;
+	}
+	return false;
+}
+
+/// 点(x, y)是否在多边形的各环围成的区域内，环之间重叠的区域按填充规则判断
+static bool insideRings(const GeometryRecord& record, double x, double y)
+{
+	int crossings = 0, winding = 0;
+	forEachSegment(record, [&](double x0, double y0, double x1, double y1)
+	{
+		// 从(x, y)向右的射线与边相交，边按上端点不含、下端点含处理，顶点不重复计数
+		if ((y0 <= y) != (y1 <= y))
+		{
+			double xCross = x0 + (y - y0) * (x1 - x0) / (y1 - y0);
+			if (x < xCross)
+			{
+				++crossings;
+				winding += y1 > y0 ? 1 : -1;
+			}
+		}
+		return false;
+	});
+	return record.fillRule == frEvenOdd ? (crossings & 1) != 0 : winding != 0;
+}
+
+/// 圆心(cx, cy)、半径r的圆（filled为false时只有圆周）是否与矩形相交
+static bool circleHitsRect(double cx, double cy, double r, bool filled, double xmin, double ymin, double xmax, double ymax)
+{
+	// 矩形内离圆心最近的点在圆外时不相交
+	double nx = std::min(std::max(cx, xmin), xmax) - cx;
+	double ny = std::min(std::max(cy, ymin), ymax) - cy;
+	if (nx * nx + ny * ny > r * r) return false;
+	if (filled) return true;
+
+	// 只有圆周时，矩形离圆心最远的角还要在圆外或圆上
+	double fx = std::max(fabs(xmin - cx), fabs(xmax - cx));
+	double fy = std::max(fabs(ymin - cy), fabs(ymax - cy));
+	return fx * fx + fy * fy >= r * r;
+}
+
+bool HitTest::hitPoint(const GeometryRecord& record, double x, double y, double tolerance)
+{
+	const Point2D* pts = record.pts;
+	double tolerance2 = tolerance * tolerance;
+	bool filled = isFilled(record);
+	switch (record.type)
+	{
+	case gtPoint:
+	{
+		double dx = pts[0].x - x, dy = pts[0].y - y;
+		return dx * dx + dy * dy <= tolerance2;
+	}
+	case gtPolyline:
+	case gtPolygon:
+	{
+		if (filled && insideRings(record, x, y)) return true;
+		return forEachSegment(record, [&](double x0, double y0, double x1, double y1)
+		{
+			return segmentDistance2(x0, y0, x1, y1, x, y) <= tolerance2;
+		});
+	}
+	case gtCircle:
+	{
+		double cx, cy, r;
+		getCircle(record, cx, cy, r);
+		double d = sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy));
+		return filled ? d <= r + tolerance : fabs(d - r) <= tolerance;
+	}
+	case gtEllipse:
+	{
+		double cx, cy, rx, ry;
+		getEllipse(record, cx, cy, rx, ry);
+		if (rx == 0 || ry == 0) return segmentDistance2(cx - rx, cy - ry, cx + rx, cy + ry, x, y) <= tolerance2;
+
+		// F(x, y) = (dx / rx)² + (dy / ry)² - 1，到椭圆的距离近似为|F| / |∇F|
+		double dx = x - cx, dy = y - cy;
+		double f = dx * dx / (rx * rx) + dy * dy / (ry * ry) - 1;
+		if (filled && f <= 0) return true;
+		double gx = 2 * dx / (rx * rx), gy = 2 * dy / (ry * ry);
+		return f * f <= tolerance2 * (gx * gx + gy * gy);
+	}
+	default:
+		return false;
+	}
+}
+
+bool HitTest::hitRect(const GeometryRecord& record, double xmin, double ymin, double xmax, double ymax)
+{
+	const Point2D* pts = record.pts;
+	bool filled = isFilled(record);
+	switch (record.type)
+	{
+	case gtPoint:
+		return pts[0].x >= xmin && pts[0].x <= xmax && pts[0].y >= ymin && pts[0].y <= ymax;
+	case gtPolyline:
+	case gtPolygon:
+	{
+		bool crossed = forEachSegment(record, [&](double x0, double y0, double x1, double y1)
+		{
+			return segmentHitsRect(x0, y0, x1, y1, xmin, ymin, xmax, ymax);
+		});
+		// 边都不与矩形相交时，填充的多边形只有包含整个矩形才相交
+		return crossed || (filled && insideRings(record, xmin, ymin));
+	}
+	case gtCircle:
+	{
+		double cx, cy, r;
+		getCircle(record, cx, cy, r);
+		return circleHitsRect(cx, cy, r, filled, xmin, ymin, xmax, ymax);
+	}
+	case gtEllipse:
+	{
+		double cx, cy, rx, ry;
+		getEllipse(record, cx, cy, rx, ry);
+		if (rx == 0 || ry == 0) return segmentHitsRect(cx - rx, cy - ry, cx + rx, cy + ry, xmin, ymin, xmax, ymax);
+
+		// 两个方向分别缩放1 / rx、1 / ry后椭圆变为单位圆，矩形仍为矩形
+		return circleHitsRect(0, 0, 1, filled, (xmin - cx) / rx, (ymin - cy) / ry, (xmax - cx) / rx, (ymax - cy) / ry);
+	}
+	default:
+		return false;
+	}
+}
+
+double HitTest::segmentDistance2(double x0, double y0, double x1, double y1, double x, double y)
+{
+	double dx = x1 - x0, dy = y1 - y0;
+	double length2 = dx * dx + dy * dy;
+	double t = length2 > 0 ? ((x - x0) * dx + (y - y0) * dy) / length2 : 0;
+	t = std::min(std::max(t, 0.0), 1.0);
+	double ex = x0 + t * dx - x, ey = y0 + t * dy - y;
+	return ex * ex + ey * ey;
+}
+
+bool HitTest::segmentHitsRect(double x0, double y0, double x1, double y1, double xmin, double ymin, double xmax, double ymax)
+{
+	double dx = x1 - x0, dy = y1 - y0;
+	double p[4] = { -dx, dx, -dy, dy };
+	double q[4] = { x0 - xmin, xmax - x0, y0 - ymin, ymax - y0 };
+	double t0 = 0, t1 = 1;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0) return false;//与该边平行且在外侧
+			continue;
+		}
+
+		double t = q[i] / p[i];
+		if (p[i] < 0) t0 = std::max(t0, t);
+		else t1 = std::min(t1, t);
+		if (t0 > t1) return false;
+	}
+	return true;
+}
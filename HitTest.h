@@ -0,0 +1,23 @@
+#pragma once
+
+struct GeometryRecord;
+
+/// 几何对象的精确拾取判断，坐标与几何对象的坐标相同
+/// 按绘制的结果判断：填充的多边形、矩形、圆和椭圆内部都能拾取，线和只画轮廓的图形只有线附近能拾取
+/// 圆和椭圆的圆心、半径按当前视图变换（g_viewTransform）取整到像素，与画出的位置一致
+/// 调用前通常先按边界框筛选（见Layer::pickGeometry、Layer::selectGeometries）
+class HitTest
+{
+public:
+	/// 点(x, y)是否拾取到几何对象：在填充的图形内，或与线（轮廓）的距离不超过tolerance
+	static bool hitPoint(const GeometryRecord& record, double x, double y, double tolerance);
+
+	/// 几何对象绘制出的部分是否与矩形[xmin, xmax] × [ymin, ymax]相交
+	static bool hitRect(const GeometryRecord& record, double xmin, double ymin, double xmax, double ymax);
+
+	/// 点(x, y)到线段(x0, y0)-(x1, y1)的距离的平方
+	static double segmentDistance2(double x0, double y0, double x1, double y1, double x, double y);
+
+	/// 线段(x0, y0)-(x1, y1)是否与矩形[xmin, xmax] × [ymin, ymax]相交，用Liang–Barsky算法求线段在矩形内的参数范围
+	static bool segmentHitsRect(double x0, double y0, double x1, double y1, double xmin, double ymin, double xmax, double ymax);
+};
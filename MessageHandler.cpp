@@ -6,27 +6,41 @@
 #include "GeometryFactory.h"
 #include "Rasterizer.h"
 #include "Painter.h"
+#include "Renderer.h"
+#include "ViewTransform.h"
+#include "Clipper.h"
+#include <math.h>
 
 // 确保包含所有必要的头文件
 #include <vector>
 #include <algorithm>
 
-enum OperationType {
-	otNone, otDrawRectangle, otDrawRectangleOutline,
-	otDrawLine, otDrawPolyline, otDrawPolygon, otDrawPolygonOutline,
-	otFillPolygon, // 新增填充多边形操作类型
-	otFillRectangle, // 新增填充矩形操作类型
-	otFillCircle, // 新增填充圆操作类型
-	otFillEllipse, // 新增填充椭圆操作类型
-	otDrawCircle, otDrawEllipse,
-	otDrawHoriLine, otDrawVertLine,
-	otDrawLineDDA, otDrawLineBresenham,
-	otClear
-};
-
 OperationType g_OperationType = otNone;//当前操作类型
 Layer* g_pLayer = NULL;
 
+///选中的几何对象在图层中的序号，绘制时高亮显示
+vector<int> g_selection;
+
+///点选的容差（像素）
+const double PICK_TOLERANCE = 3;
+
+///选中的几何对象的高亮颜色
+const Color SELECTION_COLOR = _RGB(0, 120, 215);
+
+///滚轮每滚动一格的缩放倍数
+const double ZOOM_STEP = 1.25;
+
+///方向键每次平移的像素数
+const int PAN_STEP = 50;
+
+///全图显示时图形与窗口边缘的距离（像素）
+const int FULL_EXTENT_MARGIN = 10;
+
+///帧缓冲区中已绘制的几何对象数，-1表示帧缓冲区内容已失效，需要整体重绘
+int g_renderedCount = -1;
+
+void zoomToFullExtent();
+
 ///处理菜单消息
 void handleMenuMessage(HWND hWnd, int menuID)
 {
@@ -64,6 +78,7 @@ void handleMenuMessage(HWND hWnd, int menuID)
 		g_OperationType = otClear;
 		if (g_pLayer != NULL) {
 			g_pLayer->clear();
+			g_selection.clear();
 			InvalidateRect(hWnd, NULL, TRUE);
 		}
 		break;
@@ -107,6 +122,14 @@ void handleMenuMessage(HWND hWnd, int menuID)
 		setRubberMode(rmLine);
 		setCursor(csCross);
 		break;
+	case ID_2D_SELECT:
+		g_OperationType = otSelect;
+		setRubberMode(rmRectangle);
+		setCursor(csArrow);
+		break;
+	case ID_VIEW_FULL_EXTENT:
+		zoomToFullExtent();
+		break;
 	case ID_SET_PIXEL_MODE:
 		g_Painter.setPainterMode(pmPixel);
 		InvalidateRect(hWnd, NULL, TRUE);
@@ -141,15 +164,19 @@ void handleMenuMessage(HWND hWnd, int menuID)
 		break;
 	case ID_SET_COLOR_RED:
 		g_Painter.setPenColor(RED);
+		g_renderedCount = -1;//颜色影响已绘制的填充图形，下次更新时整体重绘
 		break;
 	case ID_SET_COLOR_GREEN:
 		g_Painter.setPenColor(GREEN);
+		g_renderedCount = -1;
 		break;
 	case ID_SET_COLOR_BLUE:
 		g_Painter.setPenColor(BLUE);
+		g_renderedCount = -1;
 		break;
 	case ID_SET_COLOR_YELLOW:
 		g_Painter.setPenColor(YELLOW);
+		g_renderedCount = -1;
 		break;
 
 	}
@@ -160,17 +187,36 @@ void handleKeyMessage(int key)
 {
 	switch (key)
 	{
-	case VK_UP: // 上一行，上箭头			
+	case VK_UP: // 方向键平移视图，画面向相反方向移动，y轴向上
+		g_viewTransform.pan(0, -PAN_STEP);
+		refreshWindow();
+		break;
 	case VK_DOWN:
+		g_viewTransform.pan(0, PAN_STEP);
+		refreshWindow();
+		break;
 	case VK_LEFT:
+		g_viewTransform.pan(PAN_STEP, 0);
+		refreshWindow();
+		break;
 	case VK_RIGHT:
-	{
-		//refreshWindow();
-	}
+		g_viewTransform.pan(-PAN_STEP, 0);
+		refreshWindow();
+		break;
+	case VK_HOME: // 全图显示
+		zoomToFullExtent();
+		break;
+	case 'A': // 切换反走样
+		g_Painter.setAntiAlias(!g_Painter.isAntiAlias());
+		g_renderedCount = -1;
+		refreshWindow();
+		break;
 	}
 }
 
-Geometry* createGeometry(OperationType operationType, vector<PixelPoint>& pts);
+Geometry* createGeometry(OperationType operationType, vector<Point2D>& pts, GeometryArena* pArena);
+void updateLayer(Layer* pLayer);
+void selectGeometries(int message, int x, int y);
 
 ///处理鼠标消息
 void handleMouseMessage(int message, int x, int y, int det)
@@ -181,14 +227,26 @@ void handleMouseMessage(int message, int x, int y, int det)
 	{
 		case WM_LBUTTONDOWN:
 		case WM_MOUSEMOVE:
-		case WM_MOUSEWHEEL:
 		{
 			//refreshWindow();
 		}
 		break;
+		case WM_MOUSEWHEEL:
+		{
+			//以光标为中心缩放，向前滚动放大
+			g_viewTransform.zoomAt(x, y, pow(ZOOM_STEP, det / (double)WHEEL_DELTA));
+			refreshWindow();
+		}
+		break;
 		case WM_LBUTTONUP:
 		case WM_RBUTTONUP:
 		{
+			if (g_OperationType == otSelect)
+			{
+				selectGeometries(message, x, y);
+				return;
+			}
+
 			if (getRubberMode() == rmNone) return ;//非橡皮筋模式，退出
 
 			int c = getRubberPointCount();
@@ -225,14 +283,21 @@ void handleMouseMessage(int message, int x, int y, int det)
 			vector<PixelPoint> pts(c);//pts为动态数组，数组大小为c
 			getRubberPoints(pts.data());//pts存储橡皮筋点集合
 
+			//橡皮筋点为逻辑坐标，按视图变换转换为世界坐标
+			vector<Point2D> worldPts(c);
+			for (int i = 0; i < c; ++i)
+			{
+				g_viewTransform.logicalToWorld(pts[i].x, pts[i].y, worldPts[i].x, worldPts[i].y);
+			}
+
 			//橡皮筋操作完成，根据橡皮筋点创建几何对象
-			Geometry* pGeometry = createGeometry(g_OperationType, pts);
+			Geometry* pGeometry = createGeometry(g_OperationType, worldPts, g_pLayer->getArena());
 			if (pGeometry)
 			{
 				// 设置操作类型
 				pGeometry->operationType = g_OperationType;
 				g_pLayer->addGeometry(pGeometry);
-				refreshWindow();
+				updateLayer(g_pLayer);//只绘制新增的几何对象
 			}
 		}
 		break;
@@ -240,7 +305,6 @@ void handleMouseMessage(int message, int x, int y, int det)
 }
 
 
-void renderLayer(Layer* pLayer);
 void display()
 {
 	setYUp(true);//y轴向上
@@ -261,178 +325,125 @@ void display()
 	}
 
 	renderLayer(g_pLayer);
+	g_renderedCount = g_pLayer->getGeometryCount();
+
+	//选中的几何对象用高亮颜色画在最上面：画线使用全局画笔颜色，填充使用g_Painter的颜色，两者都要设置，之后恢复
+	Color penColor = getPenColor(), fillColor = g_Painter.getPenColor();
+	setPenColor(SELECTION_COLOR);
+	g_Painter.setPenColor(SELECTION_COLOR);
+	for (size_t i = 0; i < g_selection.size(); ++i)
+	{
+		renderGeometry((*g_pLayer)[g_selection[i]]);
+	}
+	setPenColor(penColor);
+	g_Painter.setPenColor(fillColor);
 }
 
-///根据操作类型operationType和点集合pts创建对应的几何对象
-Geometry* createGeometry(OperationType operationType, vector<PixelPoint>& pts)
+///选择模式下处理鼠标抬起：右键单击拾取光标处最上面的几何对象，左键拉出的橡皮筋矩形选择与之相交的所有几何对象
+///x、y为逻辑坐标，按视图变换转换为世界坐标后拾取，拾取的结果替换原来的选择
+void selectGeometries(int message, int x, int y)
+{
+	if (message == WM_RBUTTONUP)
+	{
+		double wx, wy;
+		g_viewTransform.logicalToWorld(x, y, wx, wy);
+		g_selection.clear();
+		int index = g_pLayer->pickGeometry(wx, wy, g_viewTransform.toWorldLength(PICK_TOLERANCE));
+		if (index >= 0) g_selection.push_back(index);
+	}
+	else
+	{
+		if (getRubberPointCount() < 2) return;//橡皮筋矩形尚未完成
+
+		int x1, y1, x2, y2;
+		getRubberPoints(x1, y1, x2, y2);
+		double wx1, wy1, wx2, wy2;
+		g_viewTransform.logicalToWorld(x1, y1, wx1, wy1);
+		g_viewTransform.logicalToWorld(x2, y2, wx2, wy2);
+		g_pLayer->selectGeometries(min(wx1, wx2), min(wy1, wy2), max(wx1, wx2), max(wy1, wy2), g_selection);
+	}
+	refreshWindow();
+}
+
+///缩放视图使图层中的所有几何对象完整显示在窗口中，图层为空时恢复为恒等变换（世界坐标即像素坐标）
+void zoomToFullExtent()
+{
+	Box2D box = g_pLayer->computeExtent();
+	if (box.isValid())
+	{
+		ClipWindow window = Clipper::getDeviceWindow(0, 0, getWindowWidth(), getWindowHeight());
+		g_viewTransform.zoomToExtent(box.xmin(), box.ymin(), box.xmax(), box.ymax(), window.inflated(-FULL_EXTENT_MARGIN));
+	}
+	else
+	{
+		g_viewTransform.reset();
+	}
+	refreshWindow();
+}
+
+///根据操作类型operationType和点集合pts（世界坐标）创建对应的几何对象，对象从pArena中分配
+Geometry* createGeometry(OperationType operationType, vector<Point2D>& pts, GeometryArena* pArena)
 {
 	int count = pts.size();
 	if (count < 2) return NULL;
 
-	PixelPoint* pData = pts.data();
+	Point2D* pData = pts.data();
 
 	///不同操作类型可以创建同一类型的图形，比如Rectange模式创建的图形也是多边形
 	switch (operationType)
 	{
 	case otDrawHoriLine:
-		return GeometryFactory::createPolylineGeometry(pData, count );
+		return GeometryFactory::createPolylineGeometry(pData, count, pArena);
 	case otDrawVertLine:
-		return GeometryFactory::createPolylineGeometry(pData, count );
+		return GeometryFactory::createPolylineGeometry(pData, count, pArena);
 	case otDrawLineDDA:
-		return GeometryFactory::createPolylineGeometry(pData, count );
+		return GeometryFactory::createPolylineGeometry(pData, count, pArena);
 	case otDrawLineBresenham:
-		return GeometryFactory::createPolylineGeometry(pData, count );
+		return GeometryFactory::createPolylineGeometry(pData, count, pArena);
 	case otDrawRectangle:
-		return GeometryFactory::creatRectangleGeometry(pData, count);
+		return GeometryFactory::creatRectangleGeometry(pData, count, pArena);
 	case otDrawRectangleOutline:
-		return GeometryFactory::creatRectangleOutlineGeometry(pData, count);
+		return GeometryFactory::creatRectangleOutlineGeometry(pData, count, pArena);
 	case otDrawPolyline:
-		return GeometryFactory::createPolylineGeometry(pData, count);
+		return GeometryFactory::createPolylineGeometry(pData, count, pArena);
 	case otDrawPolygon:
-		return GeometryFactory::createPolygonGeometry(pData, count);
+		return GeometryFactory::createPolygonGeometry(pData, count, pArena);
 	case otDrawPolygonOutline:
-		return GeometryFactory::createPolygonOutlineGeometry(pData, count);
+		return GeometryFactory::createPolygonOutlineGeometry(pData, count, pArena);
 	case otFillPolygon:
-		return GeometryFactory::createPolygonGeometry(pData, count);
+		return GeometryFactory::createPolygonGeometry(pData, count, pArena);
 	case otFillRectangle:
-		return GeometryFactory::creatRectangleGeometry(pData, count);
+		return GeometryFactory::creatRectangleGeometry(pData, count, pArena);
 	case otFillCircle:
-		return GeometryFactory::createCircleGeometry(pData, count);
+		return GeometryFactory::createCircleGeometry(pData, count, pArena);
 	case otFillEllipse:
-		return GeometryFactory::createEllipseGeometry(pData, count);
+		return GeometryFactory::createEllipseGeometry(pData, count, pArena);
 	case otDrawCircle:
-		return GeometryFactory::createCircleGeometry(pData, count);
+		return GeometryFactory::createCircleGeometry(pData, count, pArena);
 	case otDrawEllipse:
-		return GeometryFactory::createEllipseGeometry(pData, count);
+		return GeometryFactory::createEllipseGeometry(pData, count, pArena);
 	}
 	return NULL;
 }
 
-///绘制单个几何对象
-void renderGeometry(Geometry* pGeometryDef)
+///在保留的画面上只绘制图层中新增的几何对象，并显示修改的区域；画面已失效或有几何对象被删除时整体重绘
+void updateLayer(Layer* pLayer)
 {
-	switch (pGeometryDef->getGeomType())
+	int size = pLayer->getGeometryCount();
+	if (g_renderedCount < 0 || g_renderedCount > size)
 	{
-	case gtPolyline:
-	{
-		PolylineGeometry* pGeometry = (PolylineGeometry*)pGeometryDef;
-		const vector<Point2D>& pts = pGeometry->getPts();
-		int opType = pGeometryDef->operationType;
-		
-		if (opType == otDrawHoriLine && pts.size() >= 2) {
-			// 绘制水平线：保持y坐标不变，x坐标从起点到终点
-			int y = pts[0].y;
-			int x1 = pts[0].x;
-			int x2 = pts[pts.size() - 1].x;
-			if (x1 > x2) std::swap(x1, x2);
-			g_Painter.drawLine(x1, y, x2, y);
-		}
-		else if (opType == otDrawVertLine && pts.size() >= 2) {
-			// 绘制垂直线：保持x坐标不变，y坐标从起点到终点
-			int x = pts[0].x;
-			int y1 = pts[0].y;
-			int y2 = pts[pts.size() - 1].y;
-			if (y1 > y2) std::swap(y1, y2);
-			g_Painter.drawLine(x, y1, x, y2);
-		}
-		else if (opType == otDrawLineDDA) {
-			// 使用DDA算法绘制直线
-			for (int i = 0, ptsCount = pts.size(); i < ptsCount - 1; ++i)
-			{
-				g_Painter.drawLine(pts[i].x, pts[i].y, pts[(i + 1)].x, pts[(i + 1)].y);
-			}
-		}
-		/*else if (opType == otDrawLineBresenham) {
-			// 使用Bresenham算法绘制直线
-			for (int i = 0, ptsCount = pts.size(); i < ptsCount - 1; ++i)
-			{
-				g_Painter.drawLine(pts[i].x, pts[i].y, pts[(i + 1)].x, pts[(i + 1)].y);
-			}
-		}*/
-		else if (opType == otDrawPolyline) {
-			// 绘制折线：连接所有相邻的点
-			for (int i = 0, ptsCount = pts.size(); i < ptsCount - 1; ++i)
-			{
-				g_Painter.drawLine(pts[i].x, pts[i].y, pts[(i + 1)].x, pts[(i + 1)].y);
-			}
-		}
-	}
-	break;
-	case gtPolygon:
-	{
-		PolygonGeometry* pGeometry = (PolygonGeometry*)pGeometryDef;
-		const vector<Point2D>& pts = pGeometry->getPts();
-		size_t ptsCount = pts.size();
-		vector <PixelPoint> _pts(ptsCount);
-		for (int i = 0; i < ptsCount; ++i)
-		{
-			_pts[i].x = pts[i].x;
-			_pts[i].y = pts[i].y;
-		}
-		
-		// 根据操作类型决定是绘制多边形轮廓还是填充多边形
-		if (pGeometryDef->operationType == otFillPolygon) {
-			g_Painter.fillPolygon(_pts.data(), ptsCount);
-		} else if (pGeometryDef->operationType == otFillRectangle) {
-			// 填充矩形：从4个顶点中提取对角点
-			if (ptsCount >= 4) {
-				// 找到最小和最大的x、y坐标作为对角点
-				int minX = _pts[0].x, maxX = _pts[0].x;
-				int minY = _pts[0].y, maxY = _pts[0].y;
-				
-				for (int i = 1; i < ptsCount; i++) {
-					if (_pts[i].x < minX) minX = _pts[i].x;
-					if (_pts[i].x > maxX) maxX = _pts[i].x;
-					if (_pts[i].y < minY) minY = _pts[i].y;
-					if (_pts[i].y > maxY) maxY = _pts[i].y;
-				}
-				
-				g_Painter.fillRectangle(minX, minY, maxX, maxY);
-			}
-		} else {
-			g_Painter.drawPolygon(_pts.data(), ptsCount);
-		}
+		refreshWindow();
+		return;
 	}
-	break;
-	case gtCircle:
-	{
-		CircleGeometry* pGeometry = (CircleGeometry*)pGeometryDef;
 
-		// 根据操作类型决定是绘制圆轮廓还是填充圆
-		if (pGeometryDef->operationType == otFillCircle) {
-			g_Painter.fillCircle(pGeometry->x, pGeometry->y, pGeometry->r);
-		} else {
-			g_Painter.drawCircle(pGeometry->x, pGeometry->y, pGeometry->r);
-		}
-	}
-	break;
-	case gtEllipse:
-	{
-		EllipseGeometry* pGeometry = (EllipseGeometry*)pGeometryDef;
-
-		double centerX = (pGeometry->x1 + pGeometry->x2) * 0.5;
-		double centerY = (pGeometry->y1 + pGeometry->y2) * 0.5;
-		int radiusX = abs(pGeometry->x2 - pGeometry->x1) / 2;
-		int radiusY = abs(pGeometry->y2 - pGeometry->y1) / 2;
-		
-		// 根据操作类型决定是绘制椭圆轮廓还是填充椭圆
-		if (pGeometryDef->operationType == otFillEllipse) {
-			g_Painter.fillEllipse(centerX, centerY, radiusX, radiusY);
-		} else {
-			g_Painter.drawEllipse(centerX, centerY, radiusX, radiusY);
-		}
-	}
-	break;
-	}
-}
-
-void renderLayer(Layer* pLayer)
-{
 	setPenColor(pLayer->layerColor);
-	for (int i = 0, size = pLayer->getGeometryCount(); i < size; ++i)
+	for (int i = g_renderedCount; i < size; ++i)
 	{
 		renderGeometry((*pLayer)[i]);
 	}
+	g_renderedCount = size;
+
+	swapBuffer();
 }
 
 #pragma region less-used 
@@ -440,13 +451,15 @@ void renderLayer(Layer* pLayer)
 ///处理窗口大小变化消息
 void sized(int cx, int cy)
 {
-
+	g_renderedCount = -1;
 }
 
 ///初始化
 void initialize()
 {
 	g_pLayer = new Layer();
+	g_pLayer->cacheRaster = true;//窗口重绘时图层通常未修改，直接合成缓存的位图
+	g_pLayer->spatialIndex = true;//平移、缩放后只记录和绘制可见的几何对象
 }
 
 ///程序退出时清理资源
@@ -2,95 +2,221 @@
 #include "Rasterizer.h"
 #include <algorithm>
 
+// 多边形填充的保护带，坐标超出[-GUARD_BAND, GUARD_BAND]的多边形先裁剪到该范围
+static const int GUARD_BAND = 1 << 20;
+
 Padding::Padding()
 {
-    // 默认使用setPixel作为像素处理回调
+    // 默认使用setPixel作为像素处理回调，fillSpan作为像素段处理回调
     pixelCallback = setPixel;
+    spanCallback = fillSpan;
+    resetClipWindow();
 }
 
 void Padding::setPixelCallback(PixelProcessCallback callback)
 {
     pixelCallback = callback;
+    spanCallback = nullptr;
 }
 
-void Padding::fillPolygon(PixelPoint* pts, int count, Color fillColor)
+void Padding::setSpanCallback(SpanProcessCallback callback)
+{
+    spanCallback = callback;
+}
+
+void Padding::setClipWindow(const ClipWindow& window)
+{
+    clipWindow = window;
+}
+
+void Padding::resetClipWindow()
+{
+    clipWindow = ClipWindow::unbounded();
+}
+
+void Padding::emitSpan(int y, int x0, int x1, Color fillColor)
 {
-    if (pts == nullptr || count < 3) return;
+    if (y < clipWindow.ymin || y > clipWindow.ymax) return;
+    if (x0 < clipWindow.xmin) x0 = clipWindow.xmin;
+    if (x1 > clipWindow.xmax) x1 = clipWindow.xmax;
+    if (x0 > x1) return;
     
-    // 使用扫描线填充算法
-    fillPolygonScanline(pts, count, fillColor);
+    if (spanCallback) {
+        spanCallback(y, x0, x1, fillColor);
+        return;
+    }
+    
+    for (int x = x0; x <= x1; x++) {
+        pixelCallback(x, y, fillColor);
+    }
 }
 
-void Padding::fillPolygonScanline(PixelPoint* pts, int count, Color fillColor)
+void Padding::fillPolygon(PixelPoint* pts, int count, Color fillColor)
 {
-    if (pts == nullptr || count < 3) return;
+    int ringOffsets[2] = { 0, count };
+    fillPolyPolygon(pts, ringOffsets, 1, frEvenOdd, fillColor);
+}
+
+void Padding::fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color fillColor)
+{
+    if (pts == nullptr || ringCount <= 0) return;
+    int count = ringOffsets[ringCount] - ringOffsets[0];
+    if (count < 3) return;
     
-    // 找到多边形的边界框
-    int minY = pts[0].y, maxY = pts[0].y;
-    for (int i = 1; i < count; i++) {
-        if (pts[i].y < minY) minY = pts[i].y;
-        if (pts[i].y > maxY) maxY = pts[i].y;
+    int xmin = pts[ringOffsets[0]].x, xmax = xmin;
+    int ymin = pts[ringOffsets[0]].y, ymax = ymin;
+    for (int i = ringOffsets[0] + 1; i < ringOffsets[ringCount]; i++) {
+        xmin = std::min(xmin, pts[i].x);
+        xmax = std::max(xmax, pts[i].x);
+        ymin = std::min(ymin, pts[i].y);
+        ymax = std::max(ymax, pts[i].y);
     }
+    if (!clipWindow.intersects(xmin, ymin, xmax, ymax)) return;
     
-    // 对每条扫描线进行填充
-    for (int y = minY; y <= maxY; y++) {
-        std::vector<int> intersections;
-        getScanlineIntersections(pts, count, y, intersections);
-        
-        // 对交点进行排序
-        std::sort(intersections.begin(), intersections.end());
-        
-        // 填充扫描线上的像素 - 成对处理交点
-        // 如果交点数量为奇数，说明算法有问题，需要调试
-        if (intersections.size() % 2 != 0) {
-            // 交点数量为奇数，跳过这条扫描线并继续
-            // 在实际应用中，这里应该记录错误或使用备用算法
-            continue;
+    // 窗口外的行由扫描线算法直接跳过，像素段截取到窗口内，结果与不裁剪完全相同
+    // 只有超出保护带的多边形才用Sutherland–Hodgman算法裁剪，使扫描线计算不溢出
+    // 保护带与窗口无关，平移视图和分块绘制时裁剪结果不变
+    // 各环分别裁剪，裁剪后的环仍是闭合的，填充规则的结果不变
+    const ClipWindow guard = { -GUARD_BAND, -GUARD_BAND, GUARD_BAND, GUARD_BAND };
+    if (!guard.encloses(xmin, ymin, xmax, ymax)) {
+        clippedPts.clear();
+        clippedOffsets.assign(1, 0);
+        for (int r = 0; r < ringCount; r++) {
+            int ringSize = Clipper::clipPolygon(guard, pts + ringOffsets[r], ringOffsets[r + 1] - ringOffsets[r], clippedRing);
+            if (ringSize < 3) continue;
+            clippedPts.insert(clippedPts.end(), clippedRing.begin(), clippedRing.end());
+            clippedOffsets.push_back((int)clippedPts.size());
         }
-        
-        for (size_t i = 0; i < intersections.size(); i += 2) {
-            if (i + 1 < intersections.size()) {
-                int x1 = intersections[i];
-                int x2 = intersections[i + 1];
-                
-                // 确保x1 <= x2
-                if (x1 > x2) std::swap(x1, x2);
-                
-                // 填充从x1到x2的像素（包含端点）
-                for (int x = x1; x <= x2; x++) {
-                    pixelCallback(x, y, fillColor);
-                }
+        ringCount = (int)clippedOffsets.size() - 1;
+        if (ringCount == 0) return;
+        pts = clippedPts.data();
+        ringOffsets = clippedOffsets.data();
+    }
+    
+    // 使用扫描线填充算法
+    fillPolygonScanline(pts, ringOffsets, ringCount, rule, fillColor);
+}
+
+void Padding::buildEdgeTable(PixelPoint* pts, const int* ringOffsets, int ringCount)
+{
+    edgeTable.clear();
+    
+    for (int r = 0; r < ringCount; r++) {
+        int first = ringOffsets[r], last = ringOffsets[r + 1] - 1;
+        for (int i = first; i <= last; i++) {
+            int next = i < last ? i + 1 : first;
+            int y1 = pts[i].y;
+            int y2 = pts[next].y;
+            int x1 = pts[i].x;
+            int x2 = pts[next].x;
+            
+            // 跳过水平边
+            if (y1 == y2) continue;
+            
+            // 确保y1 < y2，winding记录原来的方向
+            int winding = 1;
+            if (y1 > y2) {
+                std::swap(y1, y2);
+                std::swap(x1, x2);
+                winding = -1;
             }
+            
+            // 跳过完全在窗口行范围外的边
+            if (y2 <= clipWindow.ymin || y1 > clipWindow.ymax) continue;
+            
+            // 交点x = x1 + (y - y1) * dx / dy，向零取整
+            // 拆成整数部分和余数逐行累加，结果与直接计算完全一致，且每行不需要除法
+            ScanEdge edge;
+            int dx = x2 - x1;
+            edge.dy = y2 - y1;
+            edge.dir = dx < 0 ? -1 : 1;
+            edge.step = dx / edge.dy;
+            edge.rem = (dx < 0 ? -dx : dx) % edge.dy;
+            edge.err = 0;
+            edge.x = x1;
+            edge.yMin = y1;
+            edge.yMax = y2;
+            edge.winding = winding;
+            
+            // 从窗口之前开始的边直接计算窗口第一行的交点和余数，与逐行累加的结果相同
+            if (y1 < clipWindow.ymin) {
+                long long t = (long long)(clipWindow.ymin - y1) * (dx < 0 ? -dx : dx);
+                edge.x = x1 + edge.dir * (int)(t / edge.dy);
+                edge.err = (int)(t % edge.dy);
+                edge.yMin = clipWindow.ymin;
+            }
+            edgeTable.push_back(edge);
         }
     }
+    
+    std::sort(edgeTable.begin(), edgeTable.end(),
+        [](const ScanEdge& a, const ScanEdge& b) { return a.yMin < b.yMin; });
 }
 
-void Padding::getScanlineIntersections(PixelPoint* pts, int count, int scanline, std::vector<int>& intersections)
+void Padding::fillPolygonScanline(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color fillColor)
 {
-    intersections.clear();
-    
-    for (int i = 0; i < count; i++) {
-        int next = (i + 1) % count;
-        int y1 = pts[i].y;
-        int y2 = pts[next].y;
-        int x1 = pts[i].x;
-        int x2 = pts[next].x;
+    if (pts == nullptr || ringCount <= 0) return;
+    
+    buildEdgeTable(pts, ringOffsets, ringCount);
+    if (edgeTable.empty()) return;
+    
+    activeEdges.clear();
+    size_t nextEdge = 0;
+    int y = edgeTable[0].yMin;
+    
+    while (nextEdge < edgeTable.size() || !activeEdges.empty()) {
+        // 活动边表为空时直接跳到下一条边的起始扫描线
+        if (activeEdges.empty() && edgeTable[nextEdge].yMin > y) {
+            y = edgeTable[nextEdge].yMin;
+        }
+        if (y > clipWindow.ymax) break;
+        
+        // 加入从当前扫描线开始的边
+        while (nextEdge < edgeTable.size() && edgeTable[nextEdge].yMin == y) {
+            activeEdges.push_back(&edgeTable[nextEdge]);
+            nextEdge++;
+        }
         
-        // 跳过水平边
-        if (y1 == y2) continue;
+        // 按交点x插入排序，相邻扫描线的顺序变化很小，接近线性时间
+        for (size_t i = 1; i < activeEdges.size(); i++) {
+            ScanEdge* edge = activeEdges[i];
+            size_t j = i;
+            while (j > 0 && activeEdges[j - 1]->x > edge->x) {
+                activeEdges[j] = activeEdges[j - 1];
+                j--;
+            }
+            activeEdges[j] = edge;
+        }
         
-        // 确保y1 < y2
-        if (y1 > y2) {
-            std::swap(y1, y2);
-            std::swap(x1, x2);
+        // 从左到右累计环绕数，进入内部时记下交点，离开内部时填充到该交点（包含端点）
+        // 每个环的边在扫描线上的交点数为偶数（扫描线范围左闭右开），所有边都处理完后环绕数回到0
+        int winding = 0;
+        int spanStart = 0;
+        for (size_t i = 0; i < activeEdges.size(); i++) {
+            bool wasInside = rule == frEvenOdd ? (winding & 1) != 0 : winding != 0;
+            winding += activeEdges[i]->winding;
+            bool inside = rule == frEvenOdd ? (winding & 1) != 0 : winding != 0;
+            if (!wasInside && inside) spanStart = activeEdges[i]->x;
+            else if (wasInside && !inside) emitSpan(y, spanStart, activeEdges[i]->x, fillColor);
         }
         
-        // 简化的扫描线填充规则
-        if (scanline >= y1 && scanline < y2) {
-            // 使用线性插值计算交点
-            int x = x1 + (scanline - y1) * (x2 - x1) / (y2 - y1);
-            intersections.push_back(x);
+        y++;
+        
+        // 移除已结束的边，其余边步进到下一条扫描线
+        size_t keep = 0;
+        for (size_t i = 0; i < activeEdges.size(); i++) {
+            ScanEdge* edge = activeEdges[i];
+            if (edge->yMax <= y) continue;
+            
+            edge->x += edge->step;
+            edge->err += edge->rem;
+            if (edge->err >= edge->dy) {
+                edge->err -= edge->dy;
+                edge->x += edge->dir;
+            }
+            activeEdges[keep++] = edge;
         }
+        activeEdges.resize(keep);
     }
 }
 
@@ -100,111 +226,72 @@ void Padding::fillRectangle(int x1, int y1, int x2, int y2, Color fillColor)
     if (x1 > x2) std::swap(x1, x2);
     if (y1 > y2) std::swap(y1, y2);
     
-    // 创建矩形的四个顶点
-    PixelPoint rectPts[4] = {
-        {x1, y1},  // 左上角
-        {x2, y1},  // 右上角
-        {x2, y2},  // 右下角
-        {x1, y2}   // 左下角
-    };
+    // 填充范围与按四个顶点的多边形填充相同：列[x1, x2]，行[y1, y2)（扫描线范围左闭右开）
+    // 整个矩形只与窗口求一次交集，之后每行直接提交同一段，不建立边表
+    int ylast = std::min(y2 - 1, clipWindow.ymax);
+    y1 = std::max(y1, clipWindow.ymin);
+    x1 = std::max(x1, clipWindow.xmin);
+    x2 = std::min(x2, clipWindow.xmax);
+    if (x1 > x2 || y1 > ylast) return;
     
-    // 使用多边形填充算法填充矩形
-    fillPolygon(rectPts, 4, fillColor);
+    for (int y = y1; y <= ylast; y++) {
+        if (spanCallback) {
+            spanCallback(y, x1, x2, fillColor);
+            continue;
+        }
+        for (int x = x1; x <= x2; x++) {
+            pixelCallback(x, y, fillColor);
+        }
+    }
+}
+
+void Padding::emitSymmetricSpans(int centerX, int centerY, int rows, Color fillColor)
+{
+    // 上半部分为centerY - dy行，下半部分为centerY + dy行，dy限制到窗口内的行
+    int upperFirst = std::min(rows, centerY - clipWindow.ymin);
+    int upperLast = std::max(0, centerY - clipWindow.ymax);
+    for (int dy = upperFirst; dy >= upperLast; dy--) {
+        int w = halfWidths[dy];
+        if (w < 0) continue;
+        emitSpan(centerY - dy, centerX - w, centerX + w, fillColor);
+    }
+    int lowerFirst = std::max(1, clipWindow.ymin - centerY);
+    int lowerLast = std::min(rows, clipWindow.ymax - centerY);
+    for (int dy = lowerFirst; dy <= lowerLast; dy++) {
+        int w = halfWidths[dy];
+        if (w < 0) continue;
+        emitSpan(centerY + dy, centerX - w, centerX + w, fillColor);
+    }
 }
 
 void Padding::fillCircle(int centerX, int centerY, int radius, Color fillColor)
 {
     if (radius <= 0) return;
+    if (!clipWindow.intersects(centerX - radius, centerY - radius, centerX + radius, centerY + radius)) return;
     
-    // 使用x-扫描线算法填充圆
-    int minY = centerY - radius;
-    int maxY = centerY + radius;
+    // 用中点画圆算法求每行的半宽，填充区域与Rasterizer::drawCircle画出的边界一致
+    // 八分之一圆弧上的点(x, y)对称后，第y行至少到x，第x行至少到y
+    halfWidths.assign(radius + 1, -1);
+    auto collect = [&](int x, int y) {
+        if (y <= radius && x > halfWidths[y]) halfWidths[y] = x;
+        if (x <= radius && y > halfWidths[x]) halfWidths[x] = y;
+    };
+    Rasterizer::walkCircle(radius, collect);
     
-    for (int y = minY; y <= maxY; y++) {
-        // 计算当前扫描线与圆的交点
-        int dy = y - centerY;
-        int dySquared = dy * dy;
-        int radiusSquared = radius * radius;
-        
-        // 如果 dy² > radius²，则扫描线不与圆相交
-        if (dySquared > radiusSquared) continue;
-        
-        // 计算扫描线与圆的交点x坐标
-        // 圆的方程：(x-cx)² + (y-cy)² = r²
-        // 当y固定时：(x-cx)² = r² - (y-cy)²
-        // x = cx ± sqrt(r² - (y-cy)²)
-        int discriminant = radiusSquared - dySquared;
-        if (discriminant < 0) continue;
-        
-        // 使用整数平方根近似计算
-        int sqrtDiscriminant = 0;
-        for (int i = 0; i * i <= discriminant; i++) {
-            sqrtDiscriminant = i;
-        }
-        
-        // 计算扫描线的起始和结束x坐标
-        int x1 = centerX - sqrtDiscriminant;
-        int x2 = centerX + sqrtDiscriminant;
-        
-        // 填充扫描线
-        for (int x = x1; x <= x2; x++) {
-            pixelCallback(x, y, fillColor);
-        }
-    }
+    emitSymmetricSpans(centerX, centerY, radius, fillColor);
 }
 
 void Padding::fillEllipse(int centerX, int centerY, int radiusX, int radiusY, Color fillColor)
 {
     if (radiusX <= 0 || radiusY <= 0) return;
+    if (!clipWindow.intersects(centerX - radiusX, centerY - radiusY, centerX + radiusX, centerY + radiusY)) return;
     
-    // 使用x-扫描线算法填充椭圆
-    int minY = centerY - radiusY;
-    int maxY = centerY + radiusY;
+    // 用中点椭圆算法求每行的半宽，填充区域与Rasterizer::drawEllipse画出的边界一致
+    halfWidths.assign(radiusY + 1, -1);
+    auto collect = [&](int x, int y) {
+        if (x > halfWidths[y]) halfWidths[y] = x;
+    };
+    Rasterizer::walkEllipse(radiusX, radiusY, collect);
     
-    for (int y = minY; y <= maxY; y++) {
-        // 计算当前扫描线与椭圆的交点
-        int dy = y - centerY;
-        int dySquared = dy * dy;
-        int radiusYSquared = radiusY * radiusY;
-        
-        // 如果 dy² > radiusY²，则扫描线不与椭圆相交
-        if (dySquared > radiusYSquared) continue;
-        
-        // 计算扫描线与椭圆的交点x坐标
-        // 椭圆的方程：(x-cx)²/a² + (y-cy)²/b² = 1
-        // 当y固定时：(x-cx)²/a² = 1 - (y-cy)²/b²
-        // (x-cx)² = a² * (1 - (y-cy)²/b²)
-        // x = cx ± a * sqrt(1 - (y-cy)²/b²)
-        
-        // 使用整数运算：a² * (b² - (y-cy)²) / b²
-        long long numerator = (long long)radiusX * radiusX * (radiusYSquared - dySquared);
-        long long denominator = radiusYSquared;
-        
-        if (numerator < 0) continue;
-        
-        // 计算平方根：sqrt(numerator / denominator)
-        // 简化为：sqrt(numerator) / sqrt(denominator)
-        // 由于denominator = radiusY²，所以sqrt(denominator) = radiusY
-        long long discriminant = numerator;
-        
-        // 使用整数平方根近似计算
-        int sqrtDiscriminant = 0;
-        for (int i = 0; (long long)i * i <= discriminant; i++) {
-            sqrtDiscriminant = i;
-        }
-        
-        // 计算扫描线的起始和结束x坐标
-        // x = cx ± sqrtDiscriminant / radiusY
-        // 为了避免除法，我们使用近似：x ≈ cx ± sqrtDiscriminant / radiusY
-        int x1 = centerX - sqrtDiscriminant / radiusY;
-        int x2 = centerX + sqrtDiscriminant / radiusY;
-        
-        // 确保x1 <= x2
-        if (x1 > x2) std::swap(x1, x2);
-        
-        // 填充扫描线
-        for (int x = x1; x <= x2; x++) {
-            pixelCallback(x, y, fillColor);
-        }
-    }
+    emitSymmetricSpans(centerX, centerY, radiusY, fillColor);
 }
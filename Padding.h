@@ -1,12 +1,16 @@
 #pragma once
 
 #include "Graphic.h"
+#include "Clipper.h"
 #include <vector>
 #include <algorithm>
 
 // 像素处理回调函数类型
 typedef void (*PixelProcessCallback)(int x, int y, Color color);
 
+// 水平像素段处理回调函数类型，填充y行从x0到x1（包含端点）的像素
+typedef void (*SpanProcessCallback)(int y, int x0, int x1, Color color);
+
 // 多边形填充工具类
 class Padding
 {
@@ -16,7 +20,11 @@ public:
     // 填充多边形
     void fillPolygon(PixelPoint* pts, int count, Color fillColor);
     
-    // 填充矩形
+    // 填充多个环组成的多边形（外环和洞、多个多边形），第i个环为pts[ringOffsets[i]]到pts[ringOffsets[i + 1] - 1]
+    // 所有环的边放在同一个边表中一次扫描完成，环之间重叠的区域按填充规则决定是否填充
+    void fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color fillColor);
+    
+    // 填充矩形，不经过多边形填充，像素与按四个顶点填充多边形相同
     void fillRectangle(int x1, int y1, int x2, int y2, Color fillColor);
     
     // 填充圆
@@ -25,16 +33,59 @@ public:
     // 填充椭圆
     void fillEllipse(int centerX, int centerY, int radiusX, int radiusY, Color fillColor);
     
-    // 设置像素处理回调函数
+    // 设置像素处理回调函数，同时取消像素段回调，之后按像素逐个处理
     void setPixelCallback(PixelProcessCallback callback);
     
+    // 设置像素段处理回调函数，填充时整段提交
+    void setSpanCallback(SpanProcessCallback callback);
+    
+    // 设置裁剪窗口，窗口外的行不输出也不计算，像素段截取到窗口内，完全在窗口外的图形直接跳过
+    void setClipWindow(const ClipWindow& window);
+    
+    // 取消裁剪窗口
+    void resetClipWindow();
+    
 private:
-    // 扫描线填充算法
-    void fillPolygonScanline(PixelPoint* pts, int count, Color fillColor);
+    // 多边形的边，x按扫描线增量计算：每行x增加step，余数err累加rem，满dy时再进一位
+    struct ScanEdge
+    {
+        int yMin, yMax;     // 边覆盖的扫描线范围[yMin, yMax)
+        int x;              // 当前扫描线与边的交点
+        int step, dir;      // 每行x的整数增量、余数进位方向（1或-1）
+        int rem, err, dy;   // 每行余数增量、累计余数、边的高度
+        int winding;        // 边原来的方向，y增大为1，否则为-1
+    };
+    
+    // 扫描线填充算法，使用有序边表和活动边表
+    void fillPolygonScanline(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule, Color fillColor);
+    
+    // 建立所有环的有序边表，跳过水平边，按yMin排序
+    void buildEdgeTable(PixelPoint* pts, const int* ringOffsets, int ringCount);
     
-    // 获取扫描线与多边形的交点
-    void getScanlineIntersections(PixelPoint* pts, int count, int scanline, std::vector<int>& intersections);
+    // 输出一段水平像素，有像素段回调时整段提交，否则逐像素回调
+    void emitSpan(int y, int x0, int x1, Color fillColor);
+    
+    // 按halfWidths中各行的半宽输出上下对称的像素段，行dy的像素段为[centerX - w, centerX + w]，只处理窗口内的行
+    void emitSymmetricSpans(int centerX, int centerY, int rows, Color fillColor);
     
     // 设置像素的函数指针
     PixelProcessCallback pixelCallback;
+    
+    // 填充像素段的函数指针
+    SpanProcessCallback spanCallback;
+    
+    // 裁剪窗口
+    ClipWindow clipWindow;
+    
+    // 多边形超出保护带时裁剪后的顶点和各环的起始下标
+    std::vector<PixelPoint> clippedPts;
+    std::vector<PixelPoint> clippedRing;
+    std::vector<int> clippedOffsets;
+    
+    // 有序边表和活动边表，多次填充之间复用，避免重复分配内存
+    std::vector<ScanEdge> edgeTable;
+    std::vector<ScanEdge*> activeEdges;
+    
+    // 圆和椭圆填充时各行（相对中心的dy）的半宽，-1表示该行还没有边界点
+    std::vector<int> halfWidths;
 };
@@ -1,11 +1,11 @@
 #include "Painter.h"
 #include "Padding.h"
+#include "CoverageRasterizer.h"
 #include "Rasterizer.h"
 #include <algorithm>
 #include <cmath>
 
 Painter g_Painter;
-PixelProcessCallback cb;
 
 Painter::Painter()
 {
@@ -13,25 +13,71 @@ Painter::Painter()
     mPainterMode = pmPixel;
     gridSize = 5;
     color = RED;
+    antiAlias = false;
     padding = new Padding();
+    coverage = new CoverageRasterizer();
 }
 
 Painter::~Painter()
 {
     delete padding;
+    delete coverage;
 }
 
 void Painter::drawLine(int x0, int y0, int x1, int y1)
 {
 	if( mPainterMode == pmPixel )
-		Rasterizer::drawLineDDA(x0, y0, x1, y1, setPixel );
+	{
+		FrameBufferSink sink;
+		Rasterizer::drawLineRunSlice(x0, y0, x1, y1, getLogicalWindow(), sink );
+	}
 	else
 	{
 		int g_x0, g_y0, g_x1, g_y1;
 		pixelToGrid(x0, y0, g_x0, g_y0 );
 		pixelToGrid(x1, y1, g_x1, g_y1);
 
-		Rasterizer::drawLineDDA(g_x0, g_y0, g_x1, g_y1, drawGridCell );
+		GridCellSink sink;
+		Rasterizer::drawLineRunSlice(g_x0, g_y0, g_x1, g_y1, getLogicalWindow(), sink );
+	}
+}
+
+void Painter::drawLines(const PixelPoint* pairs, int n)
+{
+	if (pairs == nullptr || n <= 0) return;
+
+	if (mPainterMode == pmPixel)
+	{
+		FrameBufferSink sink;
+		Rasterizer::drawLines(pairs, n, getLogicalWindow(), sink);
+	}
+	else
+	{
+		std::vector<PixelPoint> gridPairs(2 * n);
+		for (int i = 0; i < 2 * n; i++) {
+			pixelToGrid(pairs[i].x, pairs[i].y, gridPairs[i].x, gridPairs[i].y);
+		}
+
+		GridCellSink sink;
+		Rasterizer::drawLines(gridPairs.data(), n, getLogicalWindow(), sink);
+	}
+}
+
+void Painter::drawLineDDA(double x0, double y0, double x1, double y1)
+{
+	if (mPainterMode == pmPixel)
+	{
+		FrameBufferSink sink;
+		Rasterizer::drawLineFixed(toSubpixel(x0), toSubpixel(y0), toSubpixel(x1), toSubpixel(y1), getLogicalWindow(), sink);
+	}
+	else
+	{
+		int g_x0, g_y0, g_x1, g_y1;
+		pixelToGrid((int)x0, (int)y0, g_x0, g_y0);
+		pixelToGrid((int)x1, (int)y1, g_x1, g_y1);
+
+		GridCellSink sink;
+		Rasterizer::drawLineDDA(g_x0, g_y0, g_x1, g_y1, getLogicalWindow(), sink);
 	}
 }
 
@@ -48,40 +94,69 @@ void Painter::drawPolygon(PixelPoint* pts, int count) {
 		}
 		
 		// 绘制多边形边
+		ClipWindow window = getLogicalWindow();
+		GridCellSink sink;
 		for (int i = 0; i < count - 1; i++) {
-			Rasterizer::drawLineDDA(gridPts[i].x, gridPts[i].y, gridPts[i + 1].x, gridPts[i + 1].y, drawGridCell);
+			Rasterizer::drawLineRunSlice(gridPts[i].x, gridPts[i].y, gridPts[i + 1].x, gridPts[i + 1].y, window, sink);
 		}
 		if (count > 2) {
-			Rasterizer::drawLineDDA(gridPts[count - 1].x, gridPts[count - 1].y, gridPts[0].x, gridPts[0].y, drawGridCell);
+			Rasterizer::drawLineRunSlice(gridPts[count - 1].x, gridPts[count - 1].y, gridPts[0].x, gridPts[0].y, window, sink);
 		}
 	}
 }
 
+void Painter::drawRectangle(int x1, int y1, int x2, int y2) {
+	if (mPainterMode == pmPixel) {
+		FrameBufferSink sink;
+		Rasterizer::drawRectangle(x1, y1, x2, y2, getLogicalWindow(), sink);
+	}
+	else {
+		int g_x1, g_y1, g_x2, g_y2;
+		pixelToGrid(x1, y1, g_x1, g_y1);
+		pixelToGrid(x2, y2, g_x2, g_y2);
+		
+		GridCellSink sink;
+		Rasterizer::drawRectangle(g_x1, g_y1, g_x2, g_y2, getLogicalWindow(), sink);
+	}
+}
+
 void Painter::fillPolygon(PixelPoint* pts, int count) {
-	if (pts == nullptr || count < 3) return;
+	int ringOffsets[2] = { 0, count };
+	fillPolyPolygon(pts, ringOffsets, 1, frEvenOdd);
+}
+
+void Painter::fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule) {
+	if (pts == nullptr || ringCount <= 0 || ringOffsets[ringCount] - ringOffsets[0] < 3) return;
 	
-	if (mPainterMode == pmPixel) {
+	if (mPainterMode == pmPixel && antiAlias) {
+		coverage->fillPolyPolygon(pts, ringOffsets, ringCount, rule, color);
+	}
+	else if (mPainterMode == pmPixel) {
 		// 像素模式：直接使用Padding类填充
-		padding->setPixelCallback(setPixel);
-		padding->fillPolygon(pts, count, color);
+		padding->setSpanCallback(fillSpan);
+		padding->setClipWindow(getLogicalWindow());
+		padding->fillPolyPolygon(pts, ringOffsets, ringCount, rule, color);
 	}
 	else {
-		// 网格模式：将像素坐标转换为网格坐标后填充
+		// 网格模式：将像素坐标转换为网格坐标后填充，各环的下标不变
+		int count = ringOffsets[ringCount];
 		std::vector<PixelPoint> gridPts(count);
-		for (int i = 0; i < count; i++) {
+		for (int i = ringOffsets[0]; i < count; i++) {
 			pixelToGrid(pts[i].x, pts[i].y, gridPts[i].x, gridPts[i].y);
 		}
 		
-		// 使用Padding类填充网格坐标的多边形，使用drawGridCell作为回调
-		padding->setPixelCallback(drawGridCell);
-		padding->fillPolygon(gridPts.data(), count, color);
+		// 使用Padding类填充网格坐标的多边形，使用drawGridSpan作为回调
+		padding->setSpanCallback(drawGridSpan);
+		padding->setClipWindow(getLogicalWindow());
+		padding->fillPolyPolygon(gridPts.data(), ringOffsets, ringCount, rule, color);
 	}
 }
 
 void Painter::fillRectangle(int x1, int y1, int x2, int y2) {
 	if (mPainterMode == pmPixel) {
 		// 像素模式：直接使用Padding类填充
-		padding->setPixelCallback(setPixel);
+		padding->setSpanCallback(fillSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillRectangle(x1, y1, x2, y2, color);
 	}
 	else {
@@ -90,8 +165,9 @@ void Painter::fillRectangle(int x1, int y1, int x2, int y2) {
 		pixelToGrid(x1, y1, g_x1, g_y1);
 		pixelToGrid(x2, y2, g_x2, g_y2);
 		
-		// 使用Padding类填充网格坐标的矩形，使用drawGridCell作为回调
-		padding->setPixelCallback(drawGridCell);
+		// 使用Padding类填充网格坐标的矩形，使用drawGridSpan作为回调
+		padding->setSpanCallback(drawGridSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillRectangle(g_x1, g_y1, g_x2, g_y2, color);
 	}
 }
@@ -99,9 +175,13 @@ void Painter::fillRectangle(int x1, int y1, int x2, int y2) {
 void Painter::fillCircle(int centerX, int centerY, int radius) {
 	if (radius <= 0) return;
 	
-	if (mPainterMode == pmPixel) {
+	if (mPainterMode == pmPixel && antiAlias) {
+		coverage->fillEllipse(centerX, centerY, radius, radius, color);
+	}
+	else if (mPainterMode == pmPixel) {
 		// 像素模式：直接使用Padding类填充
-		padding->setPixelCallback(setPixel);
+		padding->setSpanCallback(fillSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillCircle(centerX, centerY, radius, color);
 	}
 	else {
@@ -111,8 +191,9 @@ void Painter::fillCircle(int centerX, int centerY, int radius) {
 		gridRadius = radius / gridSize;
 		if (gridRadius <= 0) gridRadius = 1; // 确保最小半径为1
 		
-		// 使用Padding类填充网格坐标的圆，使用drawGridCell作为回调
-		padding->setPixelCallback(drawGridCell);
+		// 使用Padding类填充网格坐标的圆，使用drawGridSpan作为回调
+		padding->setSpanCallback(drawGridSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillCircle(gridCenterX, gridCenterY, gridRadius, color);
 	}
 }
@@ -120,9 +201,13 @@ void Painter::fillCircle(int centerX, int centerY, int radius) {
 void Painter::fillEllipse(int centerX, int centerY, int radiusX, int radiusY) {
 	if (radiusX <= 0 || radiusY <= 0) return;
 	
-	if (mPainterMode == pmPixel) {
+	if (mPainterMode == pmPixel && antiAlias) {
+		coverage->fillEllipse(centerX, centerY, radiusX, radiusY, color);
+	}
+	else if (mPainterMode == pmPixel) {
 		// 像素模式：直接使用Padding类填充
-		padding->setPixelCallback(setPixel);
+		padding->setSpanCallback(fillSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillEllipse(centerX, centerY, radiusX, radiusY, color);
 	}
 	else {
@@ -134,8 +219,9 @@ void Painter::fillEllipse(int centerX, int centerY, int radiusX, int radiusY) {
 		if (gridRadiusX <= 0) gridRadiusX = 1; 
 		if (gridRadiusY <= 0) gridRadiusY = 1;
 		
-		// 使用Padding类填充网格坐标的椭圆，使用drawGridCell作为回调
-		padding->setPixelCallback(drawGridCell);
+		// 使用Padding类填充网格坐标的椭圆，使用drawGridSpan作为回调
+		padding->setSpanCallback(drawGridSpan);
+		padding->setClipWindow(getLogicalWindow());
 		padding->fillEllipse(gridCenterX, gridCenterY, gridRadiusX, gridRadiusY, color);
 	}
 }
@@ -144,7 +230,10 @@ void Painter::drawCircle(int centerX, int centerY, int radius) {
 	if (radius <= 0) return;
 	
 	if (mPainterMode == pmPixel) {
-		Rasterizer::drawCircle(centerX, centerY, radius, setPixel);
+		if (!getLogicalWindow().intersects(centerX - radius, centerY - radius, centerX + radius, centerY + radius)) return;
+
+		FrameBufferSink sink;
+		Rasterizer::drawCircle(centerX, centerY, radius, sink);
 	}
 	else {
 		int gridCenterX, gridCenterY, gridRadius;
@@ -152,7 +241,11 @@ void Painter::drawCircle(int centerX, int centerY, int radius) {
 		gridRadius = radius / gridSize;
 		if (gridRadius <= 0) gridRadius = 1; // 确保最小半径为1
 		
-		Rasterizer::drawCircle(gridCenterX, gridCenterY, gridRadius, drawGridCell);
+		if (!getLogicalWindow().intersects(gridCenterX - gridRadius, gridCenterY - gridRadius,
+			gridCenterX + gridRadius, gridCenterY + gridRadius)) return;
+
+		GridCellSink sink;
+		Rasterizer::drawCircle(gridCenterX, gridCenterY, gridRadius, sink);
 	}
 }
 
@@ -160,7 +253,10 @@ void Painter::drawEllipse(int centerX, int centerY, int radiusX, int radiusY) {
 	if (radiusX <= 0 || radiusY <= 0) return;
 
 	if (mPainterMode == pmPixel) {
-		Rasterizer::drawEllipse(centerX, centerY, radiusX, radiusY, setPixel);
+		if (!getLogicalWindow().intersects(centerX - radiusX, centerY - radiusY, centerX + radiusX, centerY + radiusY)) return;
+
+		FrameBufferSink sink;
+		Rasterizer::drawEllipse(centerX, centerY, radiusX, radiusY, sink);
 	}
 	else {
 		int gridCenterX, gridCenterY, gridRadiusX, gridRadiusY;
@@ -170,11 +266,31 @@ void Painter::drawEllipse(int centerX, int centerY, int radiusX, int radiusY) {
 		if (gridRadiusX <= 0) gridRadiusX = 1; 
 		if (gridRadiusY <= 0) gridRadiusY = 1;
 		
-		Rasterizer::drawEllipse(gridCenterX, gridCenterY, gridRadiusX, gridRadiusY, drawGridCell);
+		if (!getLogicalWindow().intersects(gridCenterX - gridRadiusX, gridCenterY - gridRadiusY,
+			gridCenterX + gridRadiusX, gridCenterY + gridRadiusY)) return;
+
+		GridCellSink sink;
+		Rasterizer::drawEllipse(gridCenterX, gridCenterY, gridRadiusX, gridRadiusY, sink);
 	}
 }
 
 
+ClipWindow Painter::getLogicalWindow() const
+{
+	ClipWindow window;
+	if (!Clipper::getViewportWindow(window)) return ClipWindow::unbounded();
+
+	if (mPainterMode == pmGrid && !isGridRasterTarget()) {
+		// 网格(x, y)覆盖逻辑坐标[x * gridSize, x * gridSize + gridSize - 1]，除法取整方向随符号变化，四边各多留一格
+		// 在网格分辨率的位图上绘制时可见区域本身就是网格坐标
+		window.xmin = window.xmin / gridSize - 1;
+		window.xmax = window.xmax / gridSize + 1;
+		window.ymin = window.ymin / gridSize - 1;
+		window.ymax = window.ymax / gridSize + 1;
+	}
+	return window;
+}
+
 void Painter::pixelToGrid(int p_x0, int p_y0, int& g_x0, int& g_y0)
 {
 	g_x0 = p_x0 / gridSize;
@@ -191,31 +307,97 @@ void Painter::drawGrid()
 	int windowHeight = getWindowHeight();
 	Color gridColor = _RGB(200, 200, 200);
 
-	// 绘制水平网格线
-	for (int y = 0; y <= windowHeight; y += gridSize) {
-		for (int x = 0; x <= windowWidth; x++) {
-			setPixel(x, y, gridColor);
+	int width, height, pitch, clipX, clipY, clipWidth, clipHeight;
+	unsigned* pBits = getFrameBuffer(width, height, pitch);
+	if (pBits == NULL || getClipRect(clipX, clipY, clipWidth, clipHeight)) {
+		// 绘制水平网格线
+		for (int y = 0; y <= windowHeight; y += gridSize) {
+			fillSpan(y, 0, windowWidth, gridColor);
+		}
+		
+		// 绘制垂直网格线
+		for (int x = 0; x <= windowWidth; x += gridSize) {
+			for (int y = 0; y <= windowHeight; y++) {
+					setPixel(x, y, gridColor);
+			}
 		}
+		return;
 	}
-	
-	// 绘制垂直网格线
-	for (int x = 0; x <= windowWidth; x += gridSize) {
-		for (int y = 0; y <= windowHeight; y++) {
-				setPixel(x, y, gridColor);
+
+	// 网格线覆盖逻辑坐标[0, windowWidth] × [0, windowHeight]，换算成帧缓冲区内的设备坐标范围
+	int origX, origY;
+	getOrig(origX, origY);
+	int upY = isYUp() ? -1 : 1;
+	int dx0 = std::max(origX, 0);
+	int dx1 = std::min(origX + windowWidth, width - 1);
+	int dy0 = std::max(std::min(origY, origY + upY * windowHeight), 0);
+	int dy1 = std::min(std::max(origY, origY + upY * windowHeight), height - 1);
+	if (dx0 > dx1 || dy0 > dy1) return;
+
+	// 竖线所在的列对每一行都相同，先求出来，水平线所在的行整行填充，其余的行只写这些列
+	std::vector<int> columns;
+	for (int dx = origX + (dx0 - origX + gridSize - 1) / gridSize * gridSize; dx <= dx1; dx += gridSize) {
+		columns.push_back(dx);
+	}
+
+	unsigned value = _BGRA(gridColor);
+	for (int dy = dy0; dy <= dy1; dy++) {
+		unsigned* row = pBits + dy * pitch;
+		int y = (dy - origY) * upY;
+		if (y % gridSize == 0) {
+			_fillDWords(row + dx0, dx1 - dx0 + 1, value, false);
+			continue;
+		}
+		for (size_t i = 0; i < columns.size(); i++) {
+			row[columns[i]] = value;
 		}
 	}
+	addDirtyRect(dx0, dy0, dx1 - dx0 + 1, dy1 - dy0 + 1);
+}
+
+// 当前线程是否在网格分辨率的位图上绘制
+static thread_local bool t_gridRasterTarget = false;
+
+void setGridRasterTarget(bool enable)
+{
+	t_gridRasterTarget = enable;
+}
+
+bool isGridRasterTarget()
+{
+	return t_gridRasterTarget;
 }
 
 void drawGridCell(int x, int y, Color color)
 {
+	if (t_gridRasterTarget) {
+		setPixel(x, y, color);
+		return;
+	}
+
 	int x0 = x * g_Painter.gridSize;
 	int y0 = y * g_Painter.gridSize;
 
-	for (int i = 0; i < g_Painter.gridSize; ++i)
+	for (int j = 0; j < g_Painter.gridSize; ++j)
 	{
-		for (int j = 0; j < g_Painter.gridSize; ++j)
-		{
-			 setPixel(x0 + i, y0 + j, color);
-		}
+		fillSpan(y0 + j, x0, x0 + g_Painter.gridSize - 1, color);
+	}
+}
+
+void drawGridSpan(int y, int x0, int x1, Color color)
+{
+	if (t_gridRasterTarget) {
+		fillSpan(y, x0, x1, color);
+		return;
+	}
+
+	int gs = g_Painter.gridSize;
+	int px0 = x0 * gs;
+	int px1 = x1 * gs + gs - 1;
+	int py0 = y * gs;
+
+	for (int j = 0; j < gs; ++j)
+	{
+		fillSpan(py0 + j, px0, px1, color);
 	}
 }
\ No newline at end of file
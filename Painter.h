@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Graphic.h"
+#include "Clipper.h"
 #include <vector>
 #include <algorithm>
 
@@ -8,6 +9,7 @@ enum PainterMode{ pmPixel, pmGrid };
 
 // 前向声明
 class Padding;
+class CoverageRasterizer;
 
 //更高层的绘制工具
 class Painter
@@ -19,14 +21,26 @@ public:
     void setPainterMode(PainterMode mode) { mPainterMode = mode; }
     void setGridSize(int gs) { gridSize = gs; }
     void setPenColor(Color col) { color = col; }
+    // 设置是否反走样，开启后像素模式下的多边形、圆和椭圆按覆盖率混合填充（见CoverageRasterizer），矩形和网格模式不受影响
+    void setAntiAlias(bool enable) { antiAlias = enable; }
 
     PainterMode getPainterMode() const { return mPainterMode; }
     int getGridSize() const { return gridSize; }
     Color getPenColor() const { return color; }
+    bool isAntiAlias() const { return antiAlias; }
 
     void drawLine(int x0, int y0, int x1, int y1);
+    // 使用定点DDA算法绘制端点带小数的直线，端点精确到1/256像素，网格模式下端点取整到网格
+    void drawLineDDA(double x0, double y0, double x1, double y1);
+    // 批量绘制线段，pairs[2i]和pairs[2i + 1]为第i条线段的两个端点，结果与逐条调用drawLine相同
+    void drawLines(const PixelPoint* pairs, int n);
     void drawPolygon(PixelPoint* pts, int count);
+    // 绘制矩形边框，(x1, y1)和(x2, y2)为任意两个对角点，像素与按四个顶点画多边形相同
+    void drawRectangle(int x1, int y1, int x2, int y2);
     void fillPolygon(PixelPoint* pts, int count);
+    // 填充多个环组成的多边形（外环和洞、多个多边形），第i个环为pts[ringOffsets[i]]到pts[ringOffsets[i + 1] - 1]
+    // 所有环一次扫描填充，环之间重叠的区域按填充规则rule决定是否填充
+    void fillPolyPolygon(PixelPoint* pts, const int* ringOffsets, int ringCount, FillRule rule);
     void fillRectangle(int x1, int y1, int x2, int y2);
     void fillCircle(int centerX, int centerY, int radius);
     void fillEllipse(int centerX, int centerY, int radiusX, int radiusY);
@@ -40,11 +54,43 @@ public:
     PainterMode mPainterMode;
     int gridSize;
     Color color;
+    bool antiAlias;
     
 private:
+    // 当前线程可见区域对应的裁剪窗口，网格模式下为网格坐标，光栅化和填充只计算窗口内的部分
+    ClipWindow getLogicalWindow() const;
+
     Padding* padding; // 填充工具对象
+    CoverageRasterizer* coverage; // 反走样填充工具对象
 };
 
 extern Painter g_Painter;
 
-void drawGridCell(int x, int y, Color color);
\ No newline at end of file
+// 设置当前线程的绘制目标是否为网格分辨率的位图：每个网格单元对应位图的一个像素，网格坐标即为位图的逻辑坐标
+// 开启后网格单元直接写为单个像素，由调用者再按块放大到帧缓冲区（见renderLayer）
+void setGridRasterTarget(bool enable);
+bool isGridRasterTarget();
+
+void drawGridCell(int x, int y, Color color);
+
+// 填充网格坐标中y行从x0到x1（包含端点）的网格单元
+void drawGridSpan(int y, int x0, int x1, Color color);
+
+// 网格单元输出器，光栅化模板输出的每个像素绘制为一个网格单元
+struct GridCellSink
+{
+	void operator()(int x, int y, Color color) const
+	{
+		drawGridCell(x, y, color);
+	}
+
+	void span(int y, int x0, int x1, Color color) const
+	{
+		drawGridSpan(y, x0, x1, color);
+	}
+
+	void column(int x, int y0, int y1, Color color) const
+	{
+		for (int y = y0; y <= y1; ++y) drawGridSpan(y, x, x, color);
+	}
+};
\ No newline at end of file
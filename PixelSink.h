@@ -0,0 +1,287 @@
+#pragma once
+
+#include "Graphic.h"
+#include "DirtyRect.h"
+#include "DynamicMatrix.h"
+#include <algorithm>
+#include <string.h>
+
+typedef void (*PixelProcessCallback)(int x, int y, Color color);
+
+// 像素输出器：光栅化模板通过sink(x, y, color)输出像素，调用在编译期确定，可被内联
+// 按段输出的光栅化模板（见Rasterizer::drawLineRunSlice）通过sink.span(y, x0, x1, color)输出y行[x0, x1]的像素，
+// 通过sink.column(x, y0, y1, color)输出x列[y0, y1]的像素（包含端点，x0 <= x1，y0 <= y1）
+
+/// 直接写帧缓冲区，构造时缓存帧缓冲区地址、坐标系和当前线程的裁剪矩形，输入为逻辑坐标
+/// 析构时提交写过的区域；设置了裁剪矩形时由设置者提交
+struct FrameBufferSink
+{
+	FrameBufferSink()
+	{
+		pBits = getFrameBuffer(width, height, pitch);
+		getOrig(origX, origY);
+		upY = isYUp() ? -1 : 1;
+
+		clipX = clipY = 0;
+		clipWidth = width;
+		clipHeight = height;
+		clipping = getClipRect(clipX, clipY, clipWidth, clipHeight);
+	}
+
+	~FrameBufferSink()
+	{
+		if (!clipping && !dirty.isEmpty())
+			addDirtyRect(dirty.x0, dirty.y0, dirty.x1 - dirty.x0 + 1, dirty.y1 - dirty.y0 + 1);
+	}
+
+	void operator()(int x, int y, Color color)
+	{
+		if (!pBits)
+		{
+			setPixel(x, y, color);
+			return;
+		}
+
+		int dx = x + origX;
+		int dy = origY + upY * y;
+		if ((unsigned)dx >= (unsigned)width || (unsigned)dy >= (unsigned)height) return;
+		if ((unsigned)(dx - clipX) >= (unsigned)clipWidth || (unsigned)(dy - clipY) >= (unsigned)clipHeight) return;
+
+		pBits[dy * pitch + dx] = _BGRA(color);
+		dirty.expand(dx, dy);
+	}
+
+	void span(int y, int x0, int x1, Color color)
+	{
+		if (!pBits)
+		{
+			fillSpan(y, x0, x1, color);
+			return;
+		}
+
+		int dy = origY + upY * y;
+		if ((unsigned)dy >= (unsigned)height || (unsigned)(dy - clipY) >= (unsigned)clipHeight) return;
+
+		int dx0 = std::max(x0 + origX, std::max(0, clipX));
+		int dx1 = std::min(x1 + origX, std::min(width, clipX + clipWidth) - 1);
+		if (dx0 > dx1) return;
+
+		_fillDWords(pBits + dy * pitch + dx0, dx1 - dx0 + 1, _BGRA(color), false);
+		dirty.expand(dx0, dy, dx1, dy);
+	}
+
+	void column(int x, int y0, int y1, Color color)
+	{
+		if (!pBits)
+		{
+			for (int y = y0; y <= y1; ++y) setPixel(x, y, color);
+			return;
+		}
+
+		int dx = x + origX;
+		if ((unsigned)dx >= (unsigned)width || (unsigned)(dx - clipX) >= (unsigned)clipWidth) return;
+
+		int dy0 = origY + upY * y0;
+		int dy1 = origY + upY * y1;
+		if (dy0 > dy1) std::swap(dy0, dy1);
+		dy0 = std::max(dy0, std::max(0, clipY));
+		dy1 = std::min(dy1, std::min(height, clipY + clipHeight) - 1);
+		if (dy0 > dy1) return;
+
+		unsigned value = _BGRA(color);
+		unsigned* p = pBits + dy0 * pitch + dx;
+		for (int dy = dy0; dy <= dy1; ++dy, p += pitch) *p = value;
+		dirty.expand(dx, dy0, dx, dy1);
+	}
+
+	/// 按覆盖率混合设备坐标dy行从dx0开始的count个像素，alpha为各像素的覆盖率（0～255），输出为dst + (color - dst)·alpha / 255
+	/// 没有帧缓冲区时覆盖率不小于一半的像素直接写入
+	void blendDeviceSpan(int dy, int dx0, const unsigned char* alpha, int count, Color color)
+	{
+		if (!pBits)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				if (alpha[i] >= 128) setDevicePixel(dx0 + i, dy, color);
+			}
+			return;
+		}
+
+		int begin, end;
+		if (!clipDeviceRow(dy, dx0, count, begin, end)) return;
+
+		// 两端覆盖率为0的像素不写，也不计入写过的区域
+		while (begin < end && alpha[begin - dx0] == 0) ++begin;
+		while (end > begin && alpha[end - 1 - dx0] == 0) --end;
+		if (begin >= end) return;
+
+		unsigned src = _BGRA(color);
+		unsigned* row = pBits + dy * pitch;
+		int dx = begin;
+#ifdef DYNAMICMATRIX_SSE2
+		for (; dx + 4 <= end; dx += 4)
+		{
+			unsigned a4;
+			memcpy(&a4, alpha + dx - dx0, 4);
+			if (a4 == 0) continue;
+			if (a4 == 0xFFFFFFFF)
+			{
+				_mm_storeu_si128((__m128i*)(row + dx), _mm_set1_epi32((int)src));
+				continue;
+			}
+			_mm_storeu_si128((__m128i*)(row + dx), blendPixel4(_mm_loadu_si128((const __m128i*)(row + dx)), src, a4));
+		}
+#endif
+		for (; dx < end; ++dx)
+		{
+			unsigned a = alpha[dx - dx0];
+			if (a != 0) row[dx] = blendPixel(row[dx], src, a);
+		}
+		dirty.expand(begin, dy, end - 1, dy);
+	}
+
+	/// 用同一覆盖率alpha混合设备坐标dy行从dx0开始的count个像素，覆盖率为255时直接填充
+	void blendDeviceRun(int dy, int dx0, int count, unsigned alpha, Color color)
+	{
+		if (alpha == 0) return;
+		if (!pBits)
+		{
+			if (alpha < 128) return;
+			for (int i = 0; i < count; ++i) setDevicePixel(dx0 + i, dy, color);
+			return;
+		}
+
+		int begin, end;
+		if (!clipDeviceRow(dy, dx0, count, begin, end)) return;
+
+		unsigned src = _BGRA(color);
+		unsigned* row = pBits + dy * pitch;
+		if (alpha == 255)
+		{
+			_fillDWords(row + begin, end - begin, src, false);
+		}
+		else
+		{
+			for (int dx = begin; dx < end; ++dx) row[dx] = blendPixel(row[dx], src, alpha);
+		}
+		dirty.expand(begin, dy, end - 1, dy);
+	}
+
+	unsigned* pBits;
+	int width, height, pitch;
+	int origX, origY, upY;
+	int clipX, clipY, clipWidth, clipHeight;
+	bool clipping;
+	DirtyRect dirty;// 写过的设备坐标区域
+
+private:
+	/// 设备坐标dy行[dx0, dx0 + count)与帧缓冲区、裁剪矩形的交集[begin, end)
+	bool clipDeviceRow(int dy, int dx0, int count, int& begin, int& end) const
+	{
+		if (dy < std::max(0, clipY) || dy >= std::min(height, clipY + clipHeight)) return false;
+		begin = std::max(dx0, std::max(0, clipX));
+		end = std::min(dx0 + count, std::min(width, clipX + clipWidth));
+		return begin < end;
+	}
+
+	/// 按覆盖率a（1～255）把src混合到dst上
+	static unsigned blendPixel(unsigned dst, unsigned src, unsigned a)
+	{
+		// 红蓝两个通道一起计算（各占16位，乘积不会相互进位），a放大到0～256后用移位代替除法
+		a += a >> 7;
+		unsigned rb = (((src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * (256 - a)) >> 8) & 0x00FF00FF;
+		unsigned g = (((src & 0x0000FF00) * a + (dst & 0x0000FF00) * (256 - a)) >> 8) & 0x0000FF00;
+		return (src & 0xFF000000) | rb | g;
+	}
+
+#ifdef DYNAMICMATRIX_SSE2
+	/// blendPixel的4路版本，a4的4个字节依次为4个像素的覆盖率，覆盖率为0的像素保持不变
+	static __m128i blendPixel4(__m128i dst, unsigned src, unsigned a4)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)a4), zero);
+		a = _mm_add_epi16(a, _mm_srli_epi16(a, 7));
+		__m128i skip = _mm_cmpeq_epi32(_mm_unpacklo_epi16(a, zero), zero);
+
+		// 每个像素的4个通道各占16位，一次处理2个像素；乘积不超过255·256，低16位即为无符号结果
+		a = _mm_unpacklo_epi16(a, a);
+		__m128i aLo = _mm_unpacklo_epi32(a, a), aHi = _mm_unpackhi_epi32(a, a);
+		const __m128i full = _mm_set1_epi16(256);
+		__m128i s = _mm_unpacklo_epi8(_mm_set1_epi32((int)src), zero);
+		__m128i dLo = _mm_unpacklo_epi8(dst, zero), dHi = _mm_unpackhi_epi8(dst, zero);
+		dLo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, aLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo))), 8);
+		dHi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, aHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi))), 8);
+		__m128i out = _mm_or_si128(_mm_and_si128(_mm_packus_epi16(dLo, dHi), _mm_set1_epi32(0x00FFFFFF)), _mm_set1_epi32((int)(src & 0xFF000000)));
+		return _mm_or_si128(_mm_and_si128(skip, dst), _mm_andnot_si128(skip, out));
+	}
+#endif
+};
+
+/// 带深度测试的输出器，所有像素使用同一深度值z
+struct DepthTestSink
+{
+	DepthTestSink(float z) : z(z) {}
+
+	void operator()(int x, int y, Color color) const
+	{
+		setPixel(x, y, z, color);
+	}
+
+	void span(int y, int x0, int x1, Color color) const
+	{
+		for (int x = x0; x <= x1; ++x) setPixel(x, y, z, color);
+	}
+
+	void column(int x, int y0, int y1, Color color) const
+	{
+		for (int y = y0; y <= y1; ++y) setPixel(x, y, z, color);
+	}
+
+	float z;
+};
+
+/// 只统计像素数量，不写入，用于估算图元的像素量
+struct CountingSink
+{
+	CountingSink() : count(0) {}
+
+	void operator()(int, int, Color)
+	{
+		++count;
+	}
+
+	void span(int, int x0, int x1, Color)
+	{
+		count += x1 - x0 + 1;
+	}
+
+	void column(int, int y0, int y1, Color)
+	{
+		count += y1 - y0 + 1;
+	}
+
+	int count;
+};
+
+/// 函数指针适配器，用于保留PixelProcessCallback接口
+struct CallbackSink
+{
+	CallbackSink(PixelProcessCallback cb) : cb(cb) {}
+
+	void operator()(int x, int y, Color color) const
+	{
+		cb(x, y, color);
+	}
+
+	void span(int y, int x0, int x1, Color color) const
+	{
+		for (int x = x0; x <= x1; ++x) cb(x, y, color);
+	}
+
+	void column(int x, int y0, int y1, Color color) const
+	{
+		for (int y = y0; y <= y1; ++y) cb(x, y, color);
+	}
+
+	PixelProcessCallback cb;
+};
@@ -0,0 +1,96 @@
+#include "RTree.h"
+#include <math.h>
+#include <algorithm>
+#include <utility>
+
+void RTree::build(const double* xmin, const double* ymin, const double* xmax, const double* ymax, int count)
+{
+	clear();
+	this->count = count;
+
+	std::vector<Node> leaves;
+	leaves.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		if (xmin[i] > xmax[i]) continue;
+		Node node = { xmin[i], ymin[i], xmax[i], ymax[i], i, 0 };
+		leaves.push_back(node);
+	}
+	if (leaves.empty()) return;
+	levels.push_back(std::move(leaves));
+
+	// 每次把当前最上层排序后每NODE_CAPACITY个分为一组，组成上一层，直到只剩一个节点；根节点不是叶节点
+	while (levels.size() == 1 || levels.back().size() > 1)
+	{
+		std::vector<Node>& children = levels.back();
+		sortTiles(children);
+
+		std::vector<Node> parents;
+		parents.reserve((children.size() + NODE_CAPACITY - 1) / NODE_CAPACITY);
+		for (size_t first = 0; first < children.size(); first += NODE_CAPACITY)
+		{
+			size_t last = std::min(first + NODE_CAPACITY, children.size());
+			Node parent = children[first];
+			for (size_t i = first + 1; i < last; ++i)
+			{
+				parent.xmin = std::min(parent.xmin, children[i].xmin);
+				parent.ymin = std::min(parent.ymin, children[i].ymin);
+				parent.xmax = std::max(parent.xmax, children[i].xmax);
+				parent.ymax = std::max(parent.ymax, children[i].ymax);
+			}
+			parent.first = (int)first;
+			parent.count = (int)(last - first);
+			parents.push_back(parent);
+		}
+		levels.push_back(std::move(parents));
+	}
+}
+
+void RTree::clear()
+{
+	levels.clear();
+	count = 0;
+}
+
+void RTree::sortTiles(std::vector<Node>& nodes)
+{
+	// P个节点组，分成S = ⌈√P⌉个竖条，每条S组
+	size_t groupCount = (nodes.size() + NODE_CAPACITY - 1) / NODE_CAPACITY;
+	size_t sliceCount = (size_t)ceil(sqrt((double)groupCount));
+	size_t sliceSize = sliceCount * NODE_CAPACITY;
+
+	std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) { return a.xmin + a.xmax < b.xmin + b.xmax; });
+	for (size_t first = 0; first < nodes.size(); first += sliceSize)
+	{
+		size_t last = std::min(first + sliceSize, nodes.size());
+		std::sort(nodes.begin() + first, nodes.begin() + last, [](const Node& a, const Node& b) { return a.ymin + a.ymax < b.ymin + b.ymax; });
+	}
+}
+
+void RTree::query(double xmin, double ymin, double xmax, double ymax, std::vector<int>& result) const
+{
+	if (levels.empty()) return;
+
+	// 待访问的节点（层号, 序号），只压入与查询范围相交的节点
+	std::vector<std::pair<int, int> > stack;
+	int top = (int)levels.size() - 1;
+	const Node& root = levels[top][0];
+	if (root.xmin > xmax || root.xmax < xmin || root.ymin > ymax || root.ymax < ymin) return;
+	stack.push_back(std::make_pair(top, 0));
+
+	while (!stack.empty())
+	{
+		int level = stack.back().first;
+		const Node& node = levels[level][stack.back().second];
+		stack.pop_back();
+
+		const std::vector<Node>& children = levels[level - 1];
+		for (int i = node.first, last = node.first + node.count; i < last; ++i)
+		{
+			const Node& child = children[i];
+			if (child.xmin > xmax || child.xmax < xmin || child.ymin > ymax || child.ymax < ymin) continue;
+			if (level == 1) result.push_back(child.first);
+			else stack.push_back(std::make_pair(level - 1, i));
+		}
+	}
+}
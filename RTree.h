@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+/// 静态R树：用STR（Sort-Tile-Recursive）算法一次装载一组矩形，按范围查询与之相交的矩形
+/// 各层的节点分别连续存放，每个节点的子节点在下一层中连续；装载后不能插入，需要时重新装载
+class RTree
+{
+public:
+	RTree() : count(0) {}
+
+	/// 装载count个矩形，第i个为[xmin[i], xmax[i]] × [ymin[i], ymax[i]]；xmin > xmax的矩形为空，查询时不会返回
+	void build(const double* xmin, const double* ymin, const double* xmax, const double* ymax, int count);
+
+	/// 清空所有矩形
+	void clear();
+
+	/// 装载的矩形数（包括空矩形）
+	int getCount() const { return count; }
+
+	/// 把与矩形[xmin, xmax] × [ymin, ymax]相交（包括边界接触）的矩形序号追加到result，顺序不定
+	void query(double xmin, double ymin, double xmax, double ymax, std::vector<int>& result) const;
+
+private:
+	/// 节点的范围和子节点在下一层中的序号[first, first + count)；叶层每个矩形一项，first为矩形序号
+	struct Node
+	{
+		double xmin, ymin, xmax, ymax;
+		int first, count;
+	};
+
+	static const int NODE_CAPACITY = 16;// 每个节点的子节点数上限
+
+	/// STR排序：先按中心的x坐标分成若干竖条，每条内再按中心的y坐标排序，使每NODE_CAPACITY个相邻的节点在空间上聚集
+	static void sortTiles(std::vector<Node>& nodes);
+
+	std::vector<std::vector<Node> > levels;// levels[0]为叶层，最后一层只有根节点，至少有两层
+	int count;
+};
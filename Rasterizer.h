@@ -1,8 +1,23 @@
 #pragma once
 
 #include "Graphic.h"
+#include "PixelSink.h"
+#include "Clipper.h"
+#include <math.h>
+#include <algorithm>
 
-typedef void (*PixelProcessCallback)(int x, int y, Color color);
+/// 亚像素坐标为24.8定点数：整数部分24位，小数部分8位（1/256像素）
+const int SUBPIXEL_BITS = 8;
+const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+/// 主方向长度不超过该值且完全在窗口内的线段逐像素求段，更长的线段用除法直接求各段的起点
+const int SHORT_LINE_LENGTH = 64;
+
+/// 浮点坐标转换为24.8定点数，四舍五入到最近的1/256像素
+inline int toSubpixel(double v)
+{
+	return (int)floor(v * SUBPIXEL_ONE + 0.5);
+}
 
 /// 光栅化器类，用于实现基本的图形绘制功能
 class Rasterizer
@@ -16,6 +31,20 @@ public:
 	/// @param y1 终点y坐标
 	static void drawLineDDA(int x0, int y0, int x1, int y1, PixelProcessCallback cb );
 
+	/// 使用DDA算法绘制直线，像素输出到sink
+	template<class Sink>
+	static void drawLineDDA(int x0, int y0, int x1, int y1, Sink& sink);
+
+	/// 使用DDA算法绘制直线在裁剪窗口内的部分，像素输出到sink，输出的像素与不裁剪时窗口内的像素相同
+	template<class Sink>
+	static void drawLineDDA(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink);
+
+	/// 使用定点DDA算法绘制端点为24.8定点数（见toSubpixel）的直线在裁剪窗口内的部分
+	/// 沿主方向逐像素取像素中心处直线的次方向坐标，四舍五入到最近的像素，次方向坐标用整数商和余数累加，内循环只有整数加法，没有累积误差
+	/// 中间结果用64位整数，坐标绝对值不超过2^22像素时不会溢出
+	template<class Sink>
+	static void drawLineFixed(int fx0, int fy0, int fx1, int fy1, const ClipWindow& window, Sink& sink);
+
 	/// 使用中点Bresenham算法绘制直线
 	/// @param x0 起点x坐标
 	/// @param y0 起点y坐标
@@ -23,6 +52,17 @@ public:
 	/// @param y1 终点y坐标
 	static void drawLineBresenham(int x0, int y0, int x1, int y1);
 
+	/// 使用run-slice算法绘制直线在裁剪窗口内的部分：主方向为x时每行的像素连成一段由sink.span输出，主方向为y时每列由sink.column输出
+	/// 像素与Bresenham算法相同（次方向坐标取到最近的整数，正好在中间时取远离起点的一侧），起点和终点交换后结果不变
+	/// 每段只需一次整数加减和比较，近水平或近竖直的长线比逐像素绘制快得多
+	template<class Sink>
+	static void drawLineRunSlice(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink);
+
+	/// 批量绘制线段，pairs[2i]和pairs[2i + 1]为第i条线段的两个端点，像素与逐条调用drawLineRunSlice相同
+	/// 裁剪判断和端点的预处理每4条线段用SIMD一起计算，颜色等状态只取一次，大量短线段的开销主要在像素上
+	template<class Sink>
+	static void drawLines(const PixelPoint* pairs, int n, const ClipWindow& window, Sink& sink);
+
 	/// 绘制多边形
 	/// @param pts 顶点数组指针
 	/// @param count 顶点数量
@@ -35,7 +75,11 @@ public:
 	/// @param y1 右下角y坐标
 	static void drawRectangle(int x0, int y0, int x1, int y1);
 
-	
+	/// 绘制矩形[x0, x1] × [y0, y1]的边框在裁剪窗口内的部分，上下两边整行由sink.span输出，左右两边整列由sink.column输出
+	/// 每条边截取到窗口内后一次输出，不经过画线算法，像素与沿四条边画线相同，角点只输出一次
+	template<class Sink>
+	static void drawRectangle(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink);
+
 
 	/// 绘制圆
 	/// @param centerX 圆心x坐标
@@ -43,10 +87,460 @@ public:
 	/// @param radius 半径
 	static void drawCircle(int cX, int cY, int radius, PixelProcessCallback cb);
 
+	/// 绘制圆，像素输出到sink
+	template<class Sink>
+	static void drawCircle(int cX, int cY, int radius, Sink& sink);
+
 	/// 绘制椭圆
 	/// @param centerX 椭圆中心x坐标
 	/// @param centerY 椭圆中心y坐标
 	/// @param radiusX x轴半径
 	/// @param radiusY y轴半径
 	static void drawEllipse(int centerX, int centerY, int radiusX, int radiusY, PixelProcessCallback cb);
+
+	/// 绘制椭圆，像素输出到sink
+	template<class Sink>
+	static void drawEllipse(int centerX, int centerY, int radiusX, int radiusY, Sink& sink);
+
+	/// 中点画圆算法，按顺序生成圆心在原点的圆在八分之一圆弧（0 <= x，从(0, r)开始）上的点，每个点调用visit(x, y)
+	/// 画圆和填充圆共用，由调用者对称得到其余部分
+	template<class Visitor>
+	static void walkCircle(int radius, Visitor& visit);
+
+	/// 中点椭圆算法，按顺序生成中心在原点的椭圆在第一象限（从(0, b)到(a, 0)）上的点，每个点调用visit(x, y)
+	/// 画椭圆和填充椭圆共用，由调用者对称得到其余部分
+	template<class Visitor>
+	static void walkEllipse(int radiusX, int radiusY, Visitor& visit);
+
+private:
+	/// run-slice算法的公共部分：主方向长major、次方向长minor（0 <= minor <= major）的直线，次方向第j行（列）的像素为主方向[start(j), start(j + 1) - 1]
+	/// 只处理主方向在[iMin, iMax]内、次方向在[jMin, jMax]内的部分，每段调用emit(j, i0, i1)
+	template<class Emit>
+	static void walkRuns(int major, int minor, long long iMin, long long iMax, long long jMin, long long jMax, Emit& emit);
+
+	/// 与walkRuns结果相同，逐像素累加误差求段，不裁剪
+	template<class Emit>
+	static void walkRunsIncremental(int major, int minor, Emit& emit);
+
+	/// 绘制一条线段，adx、ady为两端点坐标差的绝对值，inside表示线段完全在窗口内
+	template<class Sink>
+	static void drawRunSliceSegment(int x0, int y0, int x1, int y1, int adx, int ady, bool inside, const ClipWindow& window, Color color, Sink& sink);
 };
+
+/// 使用DDA算法绘制直线
+template<class Sink>
+void Rasterizer::drawLineDDA(int x0, int y0, int x1, int y1, Sink& sink)
+{
+	drawLineDDA(x0, y0, x1, y1, ClipWindow::unbounded(), sink);
+}
+
+/// 使用DDA算法绘制直线，整数端点按定点数处理
+template<class Sink>
+void Rasterizer::drawLineDDA(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink)
+{
+	drawLineFixed(x0 * SUBPIXEL_ONE, y0 * SUBPIXEL_ONE, x1 * SUBPIXEL_ONE, y1 * SUBPIXEL_ONE, window, sink);
+}
+
+/// 向负无穷取整的整数除法，b > 0
+inline long long _floorDiv(long long a, long long b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/// 定点DDA算法，a为主方向坐标、b为次方向坐标（定点数用大写）
+/// 主方向第a个像素中心处次方向坐标为B0 + (a·ONE - A0)·dB / dA，像素为floor(该值 / ONE + 1/2)
+/// 分子随a每步增加ONE·dB，按分母ONE·dA拆成商和余数逐步累加，结果与直接计算完全相同，只计算窗口内的像素
+template<class Sink>
+void Rasterizer::drawLineFixed(int fx0, int fy0, int fx1, int fy1, const ClipWindow& window, Sink& sink)
+{
+	Color color = getPenColor();
+
+	const long long ONE = SUBPIXEL_ONE;
+	const long long HALF = SUBPIXEL_ONE / 2;
+
+	bool xMajor = abs(fx1 - fx0) >= abs(fy1 - fy0);
+	long long A0 = xMajor ? fx0 : fy0, B0 = xMajor ? fy0 : fx0;
+	long long A1 = xMajor ? fx1 : fy1, B1 = xMajor ? fy1 : fx1;
+	if (A0 > A1) { std::swap(A0, A1); std::swap(B0, B1); }
+
+	long long aMin = xMajor ? window.xmin : window.ymin, aMax = xMajor ? window.xmax : window.ymax;
+	long long bMin = xMajor ? window.ymin : window.xmin, bMax = xMajor ? window.ymax : window.xmax;
+	auto emit = [&](long long a, long long b) {
+		if (b < bMin || b > bMax) return;
+		if (xMajor) sink((int)a, (int)b, color);
+		else sink((int)b, (int)a, color);
+	};
+
+	// 主方向上从起点所在的像素到终点所在的像素
+	long long first = _floorDiv(A0 + HALF, ONE);
+	long long last = _floorDiv(A1 + HALF, ONE);
+	long long dA = A1 - A0, dB = B1 - B0;
+	if (dA == 0)
+	{
+		// 两个端点在同一个1/256像素内，只画一个点
+		if (first >= aMin && first <= aMax) emit(first, _floorDiv(B0 + HALF, ONE));
+		return;
+	}
+
+	// 用扩大1个像素的窗口求线段的参数范围，换算为主方向的像素范围，两端各多算一个像素抵消浮点误差
+	first = std::max(first, aMin);
+	last = std::min(last, aMax);
+	double t0, t1;
+	if (!Clipper::clipLine(window.inflated(1), fx0 / (double)ONE, fy0 / (double)ONE, fx1 / (double)ONE, fy1 / (double)ONE, t0, t1)) return;
+	if (xMajor ? fx0 > fx1 : fy0 > fy1) { double t = 1 - t1; t1 = 1 - t0; t0 = t; }// 参数t从交换前的起点开始
+	first = std::max(first, (long long)floor((A0 + t0 * dA) / ONE) - 1);
+	last = std::min(last, (long long)ceil((A0 + t1 * dA) / ONE) + 1);
+	if (first > last) return;
+
+	long long den = ONE * dA;
+	long long num = B0 * dA + (first * ONE - A0) * dB + HALF * dA;
+	long long b = _floorDiv(num, den);
+	long long rem = num - b * den;
+
+	long long inc = ONE * dB;
+	long long step = _floorDiv(inc, den);
+	long long stepRem = inc - step * den;
+	for (long long a = first; a <= last; ++a)
+	{
+		emit(a, b);
+		b += step;
+		rem += stepRem;
+		if (rem >= den)
+		{
+			rem -= den;
+			++b;
+		}
+	}
+}
+
+/// run-slice算法，第j段从start(j) = ceil((2j - 1)·major / (2·minor))开始（j >= 1），即次方向坐标取整后为j的第一个位置
+/// 相邻两段的起点相差floor(major / minor)或再多1，用余数rem = start(j)·2minor - (2j - 1)·major判断，不需要除法
+template<class Emit>
+void Rasterizer::walkRuns(int major, int minor, long long iMin, long long iMax, long long jMin, long long jMax, Emit& emit)
+{
+	if (iMin < 0) iMin = 0;
+	if (iMax > major) iMax = major;
+	if (iMin > iMax) return;
+
+	if (minor == 0)
+	{
+		if (jMin <= 0 && jMax >= 0) emit(0, (int)iMin, (int)iMax);
+		return;
+	}
+
+	// 主方向位置i对应的段号为floor((2i·minor + major) / (2major))，段号随i单调不减，由主方向范围求出段号范围
+	long long twoMajor = 2LL * major;
+	long long denom = 2LL * minor;
+	long long first = std::max(jMin, (2 * iMin * minor + major) / twoMajor);
+	long long last = std::min(jMax, (2 * iMax * minor + major) / twoMajor);
+	if (first > last) return;
+
+	// 直接求第一段的起点，以及下一段的起点和余数
+	long long start = 0;
+	if (first > 0)
+	{
+		long long num = (2 * first - 1) * major;
+		start = (num + denom - 1) / denom;
+	}
+	long long num = (2 * first + 1) * major;
+	long long next = (num + denom - 1) / denom;
+	long long rem = next * denom - num;
+
+	long long step = twoMajor / denom;
+	long long stepRem = twoMajor % denom;
+	for (long long j = first; j <= last; ++j)
+	{
+		long long i0 = std::max(start, iMin);
+		long long i1 = std::min(next - 1, iMax);
+		if (i0 <= i1) emit((int)j, (int)i0, (int)i1);
+
+		start = next;
+		next += step;
+		rem -= stepRem;
+		if (rem < 0)
+		{
+			rem += denom;
+			++next;
+		}
+	}
+}
+
+/// 逐像素累加误差求出各段，不需要除法，用于完全在窗口内的短线段
+template<class Emit>
+void Rasterizer::walkRunsIncremental(int major, int minor, Emit& emit)
+{
+	// e = 2i·minor + major - 2j·major，落在[0, 2major)内时第i个像素属于第j段
+	int start = 0, j = 0;
+	long long e = major;
+	for (int i = 1; i <= major; ++i)
+	{
+		e += 2LL * minor;
+		if (e >= 2LL * major)
+		{
+			emit(j, start, i - 1);
+			++j;
+			start = i;
+			e -= 2LL * major;
+		}
+	}
+	emit(j, start, major);
+}
+
+/// 按主方向整段输出线段，adx、ady为两端点坐标差的绝对值
+template<class Sink>
+void Rasterizer::drawRunSliceSegment(int x0, int y0, int x1, int y1, int adx, int ady, bool inside, const ClipWindow& window, Color color, Sink& sink)
+{
+	// 完全在窗口内的短线段逐像素求段，比求段起点的除法快
+	bool incremental = inside && std::max(adx, ady) <= SHORT_LINE_LENGTH;
+
+	if (adx >= ady)
+	{
+		// 主方向为x，从左端点开始
+		if (x0 > x1) { std::swap(x0, x1); std::swap(y0, y1); }
+		int sy = y1 >= y0 ? 1 : -1;
+
+		auto emit = [&](int j, int i0, int i1) {
+			sink.span(y0 + sy * j, x0 + i0, x0 + i1, color);
+		};
+		if (incremental)
+		{
+			walkRunsIncremental(adx, ady, emit);
+			return;
+		}
+
+		long long jMin = sy > 0 ? (long long)window.ymin - y0 : (long long)y0 - window.ymax;
+		long long jMax = sy > 0 ? (long long)window.ymax - y0 : (long long)y0 - window.ymin;
+		walkRuns(adx, ady, (long long)window.xmin - x0, (long long)window.xmax - x0, jMin, jMax, emit);
+	}
+	else
+	{
+		// 主方向为y，从下端点开始
+		if (y0 > y1) { std::swap(x0, x1); std::swap(y0, y1); }
+		int sx = x1 >= x0 ? 1 : -1;
+
+		auto emit = [&](int j, int i0, int i1) {
+			sink.column(x0 + sx * j, y0 + i0, y0 + i1, color);
+		};
+		if (incremental)
+		{
+			walkRunsIncremental(ady, adx, emit);
+			return;
+		}
+
+		long long jMin = sx > 0 ? (long long)window.xmin - x0 : (long long)x0 - window.xmax;
+		long long jMax = sx > 0 ? (long long)window.xmax - x0 : (long long)x0 - window.xmin;
+		walkRuns(ady, adx, (long long)window.ymin - y0, (long long)window.ymax - y0, jMin, jMax, emit);
+	}
+}
+
+/// 使用run-slice算法绘制直线
+template<class Sink>
+void Rasterizer::drawLineRunSlice(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink)
+{
+	bool inside = window.encloses(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+	drawRunSliceSegment(x0, y0, x1, y1, abs(x1 - x0), abs(y1 - y0), inside, window, getPenColor(), sink);
+}
+
+/// 批量绘制线段，每4条线段用SSE2一起求端点坐标差的绝对值，并判断是否完全在窗口外或窗口内
+template<class Sink>
+void Rasterizer::drawLines(const PixelPoint* pairs, int n, const ClipWindow& window, Sink& sink)
+{
+	if (pairs == NULL || n <= 0) return;
+
+	Color color = getPenColor();
+	int i = 0;
+
+#ifdef DYNAMICMATRIX_SSE2
+	const __m128i xmin = _mm_set1_epi32(window.xmin), xmax = _mm_set1_epi32(window.xmax);
+	const __m128i ymin = _mm_set1_epi32(window.ymin), ymax = _mm_set1_epi32(window.ymax);
+
+	// 有符号32位整数的最小、最大值和绝对值，SSE2没有对应的指令
+	auto minEpi32 = [](__m128i a, __m128i b) { __m128i gt = _mm_cmpgt_epi32(a, b); return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a)); };
+	auto maxEpi32 = [](__m128i a, __m128i b) { __m128i gt = _mm_cmpgt_epi32(a, b); return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b)); };
+	auto absEpi32 = [](__m128i a) { __m128i sign = _mm_srai_epi32(a, 31); return _mm_sub_epi32(_mm_xor_si128(a, sign), sign); };
+
+	for (; i + 4 <= n; i += 4)
+	{
+		// 每条线段为{x0, y0, x1, y1}，4条线段转置为X0、Y0、X1、Y1四个向量
+		const __m128i* p = (const __m128i*)(pairs + 2 * i);
+		__m128i s0 = _mm_loadu_si128(p), s1 = _mm_loadu_si128(p + 1);
+		__m128i s2 = _mm_loadu_si128(p + 2), s3 = _mm_loadu_si128(p + 3);
+		__m128i t0 = _mm_unpacklo_epi32(s0, s1), t1 = _mm_unpackhi_epi32(s0, s1);
+		__m128i t2 = _mm_unpacklo_epi32(s2, s3), t3 = _mm_unpackhi_epi32(s2, s3);
+		__m128i X0 = _mm_unpacklo_epi64(t0, t2), Y0 = _mm_unpackhi_epi64(t0, t2);
+		__m128i X1 = _mm_unpacklo_epi64(t1, t3), Y1 = _mm_unpackhi_epi64(t1, t3);
+
+		__m128i minX = minEpi32(X0, X1), maxX = maxEpi32(X0, X1);
+		__m128i minY = minEpi32(Y0, Y1), maxY = maxEpi32(Y0, Y1);
+
+		// 包围盒在窗口某条边外侧的线段不绘制，包围盒在窗口内的线段不需要裁剪
+		__m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(minX, xmax), _mm_cmplt_epi32(maxX, xmin)),
+			_mm_or_si128(_mm_cmpgt_epi32(minY, ymax), _mm_cmplt_epi32(maxY, ymin)));
+		__m128i notInside = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(minX, xmin), _mm_cmpgt_epi32(maxX, xmax)),
+			_mm_or_si128(_mm_cmplt_epi32(minY, ymin), _mm_cmpgt_epi32(maxY, ymax)));
+		int outsideMask = _mm_movemask_ps(_mm_castsi128_ps(outside));
+		int insideMask = ~_mm_movemask_ps(_mm_castsi128_ps(notInside));
+		if (outsideMask == 0xF) continue;
+
+		int adx[4], ady[4];
+		_mm_storeu_si128((__m128i*)adx, absEpi32(_mm_sub_epi32(X1, X0)));
+		_mm_storeu_si128((__m128i*)ady, absEpi32(_mm_sub_epi32(Y1, Y0)));
+
+		for (int k = 0; k < 4; ++k)
+		{
+			if (outsideMask & (1 << k)) continue;
+			const PixelPoint* seg = pairs + 2 * (i + k);
+			drawRunSliceSegment(seg[0].x, seg[0].y, seg[1].x, seg[1].y, adx[k], ady[k], (insideMask >> k) & 1, window, color, sink);
+		}
+	}
+#endif
+
+	for (; i < n; ++i)
+	{
+		const PixelPoint* seg = pairs + 2 * i;
+		int x0 = std::min(seg[0].x, seg[1].x), x1 = std::max(seg[0].x, seg[1].x);
+		int y0 = std::min(seg[0].y, seg[1].y), y1 = std::max(seg[0].y, seg[1].y);
+		if (!window.intersects(x0, y0, x1, y1)) continue;
+
+		drawRunSliceSegment(seg[0].x, seg[0].y, seg[1].x, seg[1].y, x1 - x0, y1 - y0, window.encloses(x0, y0, x1, y1), window, color, sink);
+	}
+}
+
+/// 绘制矩形边框，上下两边包含角点，左右两边只有中间的部分
+template<class Sink>
+void Rasterizer::drawRectangle(int x0, int y0, int x1, int y1, const ClipWindow& window, Sink& sink)
+{
+	if (x0 > x1) std::swap(x0, x1);
+	if (y0 > y1) std::swap(y0, y1);
+	if (!window.intersects(x0, y0, x1, y1)) return;
+
+	Color color = getPenColor();
+	int sx0 = std::max(x0, window.xmin), sx1 = std::min(x1, window.xmax);
+	if (y0 >= window.ymin) sink.span(y0, sx0, sx1, color);
+	if (y1 != y0 && y1 <= window.ymax) sink.span(y1, sx0, sx1, color);
+
+	int sy0 = std::max(y0 + 1, window.ymin), sy1 = std::min(y1 - 1, window.ymax);
+	if (sy0 > sy1) return;
+	if (x0 >= window.xmin) sink.column(x0, sy0, sy1, color);
+	if (x1 != x0 && x1 <= window.xmax) sink.column(x1, sy0, sy1, color);
+}
+
+/// 绘制圆（使用中点Bresenham画圆算法）
+template<class Sink>
+void Rasterizer::drawCircle(int cX, int cY, int radius, Sink& sink)
+{
+	if (radius <= 0) return;
+
+	Color color = getPenColor();
+
+	auto drawCirclePoints = [&](int x, int y) {
+		sink(cX + x, cY + y, color);
+		sink(cX - x, cY + y, color);
+		sink(cX + x, cY - y, color);
+		sink(cX - x, cY - y, color);
+		sink(cX + y, cY + x, color);
+		sink(cX - y, cY + x, color);
+		sink(cX + y, cY - x, color);
+		sink(cX - y, cY - x, color);
+		};
+
+	walkCircle(radius, drawCirclePoints);
+}
+
+/// 中点Bresenham画圆算法
+template<class Visitor>
+void Rasterizer::walkCircle(int radius, Visitor& visit)
+{
+	if (radius <= 0) return;
+
+	int x = 0;
+	int y = radius;
+	int d = 1 - radius;//设置误差，避免浮点数
+
+	visit(x, y);
+
+	while (x < y)
+	{
+		if (d < 0)
+		{
+			d += 2 * x + 3;
+		}
+		else
+		{
+			d += 2 * (x - y) + 5;
+			y--;
+		}
+		x++;
+		visit(x, y);
+	}
+}
+
+/// 绘制椭圆（使用中点椭圆算法）
+template<class Sink>
+void Rasterizer::drawEllipse(int centerX, int centerY, int radiusX, int radiusY, Sink& sink)
+{
+	if (radiusX <= 0 || radiusY <= 0) return;
+
+	Color color = getPenColor();
+
+	auto drawEllipsePoints = [&](int x, int y) {
+		sink(centerX + x, centerY + y, color);
+		sink(centerX - x, centerY + y, color);
+		sink(centerX + x, centerY - y, color);
+		sink(centerX - x, centerY - y, color);
+	};
+
+	walkEllipse(radiusX, radiusY, drawEllipsePoints);
+}
+
+/// 中点椭圆算法，判别式和比较用64位整数，半径较大时a²·y不会溢出
+template<class Visitor>
+void Rasterizer::walkEllipse(int radiusX, int radiusY, Visitor& visit)
+{
+	if (radiusX <= 0 || radiusY <= 0) return;
+
+	long long a = radiusX;
+	long long b = radiusY;
+
+	// 第一区域：斜率 < 1
+	int x = 0;
+	int y = radiusY;
+	long long a2 = a * a;
+	long long b2 = b * b;
+	long long d1 = b2 - a2 * b + a2 / 4;
+
+	visit(x, y);
+
+	while (b2 * x < a2 * y)
+	{
+		if (d1 < 0)
+		{
+			d1 += b2 * (2 * x + 3);
+		}
+		else
+		{
+			d1 += b2 * (2 * x + 3) + a2 * (-2 * y + 2);
+			y--;
+		}
+		x++;
+		visit(x, y);
+	}
+
+	// 第二区域：斜率 >= 1
+	long long d2 = (long long)(b2 * (x + 0.5) * (x + 0.5) + a2 * (y - 1) * (y - 1) - a2 * b2);
+
+	while (y > 0)
+	{
+		if (d2 < 0)
+		{
+			d2 += b2 * (2 * x + 2) + a2 * (-2 * y + 3);
+			x++;
+		}
+		else
+		{
+			d2 += a2 * (-2 * y + 3);
+		}
+		y--;
+		visit(x, y);
+	}
+}
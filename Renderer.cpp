@@ -0,0 +1,348 @@
+#include "Renderer.h"
+#include "Painter.h"
+#include "TileRenderer.h"
+#include "DisplayList.h"
+#include "DynamicMatrix.h"
+#include "Clipper.h"
+
+///几何对象数不少于该值时分块并行绘制，对象较少时线程同步的开销比绘制本身大
+const int TILED_RENDER_MIN_COUNT = 64;
+
+///图层位图中未绘制的像素值，_BGRA得到的颜色alpha字节为0，不会与该值相同
+const unsigned RASTER_TRANSPARENT = 0x01000000;
+
+///决定图层位图内容的绘制状态，任一项改变后位图失效
+struct RasterKey
+{
+	unsigned version;
+	unsigned viewVersion;
+	int width, height;
+	int origX, origY;
+	bool yUp;
+	PainterMode mode;
+	int gridSize;
+	Color color;// 填充颜色（g_Painter的颜色）
+	Color lineColor;// 画线颜色（全局画笔颜色，绘制图层时为图层颜色）
+
+	bool operator==(const RasterKey& other) const
+	{
+		return version == other.version && viewVersion == other.viewVersion && width == other.width && height == other.height
+			&& origX == other.origX && origY == other.origY && yUp == other.yUp
+			&& mode == other.mode && gridSize == other.gridSize && color == other.color && lineColor == other.lineColor;
+	}
+};
+
+///图层的绘制缓存
+struct LayerRenderCache : LayerCache
+{
+	LayerRenderCache() : rasterValid(false) {}
+
+	DisplayList displayList;// 图层当前版本的显示列表
+	DynamicMatrix<unsigned> raster;// 图层单独绘制的结果，未绘制的像素为RASTER_TRANSPARENT
+	RasterKey rasterKey;// raster对应的绘制状态
+	bool rasterValid;
+};
+
+///获取图层的绘制缓存，没有时创建
+static LayerRenderCache* getRenderCache(Layer* pLayer)
+{
+	if (pLayer->pCache == NULL) pLayer->pCache = new LayerRenderCache();
+	return static_cast<LayerRenderCache*>(pLayer->pCache);
+}
+
+void renderGeometry(Geometry* pGeometry, Painter& painter)
+{
+	emitGeometry(pGeometry, painter);
+}
+
+void renderGeometry(Geometry* pGeometry)
+{
+	renderGeometry(pGeometry, g_Painter);
+}
+
+bool transformSegment(double x0, double y0, double x1, double y1, PixelPoint& p0, PixelPoint& p1)
+{
+	const ViewTransform& view = g_viewTransform;
+	view.worldToLogical(x0, y0, x0, y0);
+	view.worldToLogical(x1, y1, x1, y1);
+
+	double t0, t1;
+	if (!Clipper::clipLine(ViewTransform::getGuardBand(), x0, y0, x1, y1, t0, t1)) return false;
+	p0.x = ViewTransform::roundToPixel(x0 + t0 * (x1 - x0));
+	p0.y = ViewTransform::roundToPixel(y0 + t0 * (y1 - y0));
+	p1.x = ViewTransform::roundToPixel(x0 + t1 * (x1 - x0));
+	p1.y = ViewTransform::roundToPixel(y0 + t1 * (y1 - y0));
+	return true;
+}
+
+int transformRing(const Point2D* pts, int count, std::vector<PixelPoint>& out)
+{
+	const ViewTransform& view = g_viewTransform;
+	thread_local std::vector<LogicalPoint> ring, clipped;
+	ring.resize(count);
+	bool inside = true;
+	for (int i = 0; i < count; ++i)
+	{
+		view.worldToLogical(pts[i].x, pts[i].y, ring[i].x, ring[i].y);
+		inside = inside && ViewTransform::inGuardBand(ring[i].x, ring[i].y);
+	}
+
+	// 通常整个环都在保护带内，直接取整
+	const LogicalPoint* result = ring.data();
+	if (!inside)
+	{
+		count = Clipper::clipPolygon(ViewTransform::getGuardBand(), ring.data(), count, clipped);
+		result = clipped.data();
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		PixelPoint pt = { ViewTransform::roundToPixel(result[i].x), ViewTransform::roundToPixel(result[i].y) };
+		out.push_back(pt);
+	}
+	return count;
+}
+
+int transformLargeEllipse(double cx, double cy, double rx, double ry, std::vector<PixelPoint>& out)
+{
+	// 弦与弧的距离不超过1/4像素，比取整的误差小
+	const double FLATNESS = 0.25;
+	thread_local std::vector<LogicalPoint> ring, clipped;
+	ClipWindow guard = ViewTransform::getGuardBand();
+	int count = Clipper::flattenEllipse(guard, cx, cy, rx, ry, FLATNESS, ring);
+	count = Clipper::clipPolygon(guard, ring.data(), count, clipped);
+
+	out.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		out[i].x = ViewTransform::roundToPixel(clipped[i].x);
+		out[i].y = ViewTransform::roundToPixel(clipped[i].y);
+	}
+	return count;
+}
+
+///图层开启spatialIndex时用R树查询边界框与逻辑坐标窗口window相交的几何对象，即需要回放的显示列表项
+///窗口按视图变换转换为世界坐标后查询
+///@return 可见项的序号，所有对象都可见（或未开启spatialIndex）时返回NULL，回放整个显示列表
+static const std::vector<int>* getVisibleItems(Layer* pLayer, const ClipWindow& window)
+{
+	if (!pLayer->spatialIndex) return NULL;
+
+	// 图元坐标为几何对象的坐标按视图变换后取整，反走样的边缘和网格模式下的网格单元还会超出一些（见TileRenderer::binItems）
+	int margin = g_Painter.getPainterMode() == pmGrid ? 3 * g_Painter.getGridSize() : 2;
+	double xmin, ymin, xmax, ymax;
+	g_viewTransform.getWorldWindow(window.inflated(margin), xmin, ymin, xmax, ymax);
+	static std::vector<int> visible;
+	pLayer->queryGeometries(xmin, ymin, xmax, ymax, visible);
+	return (int)visible.size() < pLayer->getGeometryCount() ? &visible : NULL;
+}
+
+///记录显示列表中将要回放的项，pItems不为NULL时只记录其中的项，已记录的项不重复记录
+static void recordDisplayList(DisplayList& displayList, const std::vector<int>* pItems)
+{
+	if (pItems) displayList.recordItems(*pItems);
+	else displayList.recordAll();
+}
+
+///把显示列表绘制到当前绘制目标，pItems不为NULL时只绘制其中的项
+static void drawDisplayList(DisplayList& displayList, const std::vector<int>* pItems)
+{
+	recordDisplayList(displayList, pItems);
+
+	int width, height, pitch;
+	int itemCount = pItems ? (int)pItems->size() : displayList.getItemCount();
+	if (itemCount >= TILED_RENDER_MIN_COUNT && g_tileRenderer.getThreadCount() > 1
+		&& getFrameBuffer(width, height, pitch) != NULL)
+	{
+		g_tileRenderer.render(displayList, pItems);
+		return;
+	}
+
+	if (pItems) displayList.replayItems(*pItems, g_Painter);
+	else displayList.replay(g_Painter);
+}
+
+///网格分辨率位图与帧缓冲区的对应关系：位图像素(c, r)对应帧缓冲区中左上角为(c * gridSize - phaseX, r * gridSize - phaseY)的gridSize × gridSize块
+///位图的原点取为(origX, origY)，使网格坐标即为位图的逻辑坐标
+struct GridRasterLayout
+{
+	int width, height;
+	int phaseX, phaseY;
+	int origX, origY;
+};
+
+///a除以b的非负余数，b > 0
+static int positiveMod(int a, int b)
+{
+	int m = a % b;
+	return m < 0 ? m + b : m;
+}
+
+///按当前的原点和y轴方向求width × height的帧缓冲区对应的网格分辨率位图
+static GridRasterLayout getGridRasterLayout(int width, int height, int gridSize)
+{
+	int origX, origY;
+	getOrig(origX, origY);
+
+	// 网格x列覆盖设备坐标[origX + x * gridSize, origX + x * gridSize + gridSize - 1]
+	// y轴向上时网格y行覆盖[origY - y * gridSize - gridSize + 1, origY - y * gridSize]，向下时覆盖[origY + y * gridSize, origY + y * gridSize + gridSize - 1]
+	int firstX = origX, firstY = isYUp() ? origY + 1 : origY;// 网格0列、y轴向上时网格-1行（向下时网格0行）的起点
+	GridRasterLayout layout;
+	layout.phaseX = positiveMod(-firstX, gridSize);
+	layout.phaseY = positiveMod(-firstY, gridSize);
+	layout.origX = (firstX + layout.phaseX) / gridSize;
+	layout.origY = isYUp() ? (firstY + layout.phaseY) / gridSize - 1 : (firstY + layout.phaseY) / gridSize;
+	layout.width = (width + layout.phaseX + gridSize - 1) / gridSize;
+	layout.height = (height + layout.phaseY + gridSize - 1) / gridSize;
+	return layout;
+}
+
+///设备坐标矩形，合成位图时的目标区域
+struct CompositeRect
+{
+	int x, y, width, height;
+};
+
+///合成位图的目标区域：当前线程的裁剪矩形（未设置时为整个帧缓冲区）与帧缓冲区的交集
+static CompositeRect getCompositeRect(int width, int height)
+{
+	CompositeRect rect = { 0, 0, width, height };
+	int x, y, w, h;
+	if (getClipRect(x, y, w, h))
+	{
+		rect.x = std::max(x, 0);
+		rect.y = std::max(y, 0);
+		rect.width = std::min(x + w, width) - rect.x;
+		rect.height = std::min(y + h, height) - rect.y;
+	}
+	return rect;
+}
+
+///把网格分辨率的位图按块放大合成到帧缓冲区的rect区域，RASTER_TRANSPARENT的像素保持不变
+static void compositeGridRaster(DynamicMatrix<unsigned>& raster, const GridRasterLayout& layout, int gridSize, unsigned* pBits, int width, const CompositeRect& rect, int pitch)
+{
+	// 每行位图先放大成一行，再复制到对应的gridSize行
+	thread_local std::vector<unsigned> expanded;
+	expanded.resize(width);
+	for (int r = 0; r < layout.height; ++r)
+	{
+		int y0 = std::max(r * gridSize - layout.phaseY, rect.y);
+		int y1 = std::min(r * gridSize - layout.phaseY + gridSize, rect.y + rect.height);
+		if (y0 >= y1) continue;
+		_expandDWords(expanded.data(), raster[r], width, gridSize, layout.phaseX);
+		for (int y = y0; y < y1; ++y)
+		{
+			_copyDWordsKeyed(pBits + y * pitch + rect.x, expanded.data() + rect.x, rect.width, RASTER_TRANSPARENT);
+		}
+	}
+}
+
+///位图缓存失效时把图层重新绘制到位图，再将位图中已绘制的像素合成到帧缓冲区
+///网格模式下位图为网格分辨率，每个网格单元只写一个像素，合成时再按块放大
+///设置了裁剪矩形时只合成矩形内的部分，已修改区域由调用者提交
+static void renderLayerRaster(LayerRenderCache* pCache, Layer* pLayer, unsigned* pBits, int width, int height, int pitch)
+{
+	RasterKey key;
+	key.version = pLayer->version;
+	key.viewVersion = g_viewTransform.getVersion();
+	key.width = width;
+	key.height = height;
+	getOrig(key.origX, key.origY);
+	key.yUp = isYUp();
+	key.mode = g_Painter.getPainterMode();
+	key.gridSize = g_Painter.getGridSize();
+	key.color = g_Painter.getPenColor();
+	key.lineColor = getPenColor();
+
+	bool grid = key.mode == pmGrid;
+	GridRasterLayout layout;
+	if (grid) layout = getGridRasterLayout(width, height, key.gridSize);
+
+	DynamicMatrix<unsigned>& raster = pCache->raster;
+	if (!pCache->rasterValid || !(pCache->rasterKey == key))
+	{
+		// 位图总是对应整个帧缓冲区，绘制位图期间取消裁剪矩形，之后恢复
+		const std::vector<int>* pVisible = getVisibleItems(pLayer, Clipper::getDeviceWindow(0, 0, width, height));
+		int clipX, clipY, clipWidth, clipHeight;
+		bool clipped = getClipRect(clipX, clipY, clipWidth, clipHeight);
+		if (clipped) resetClipRect();
+
+		int rasterWidth = grid ? layout.width : width;
+		int rasterHeight = grid ? layout.height : height;
+		raster.setSize(rasterWidth, rasterHeight);
+		raster.clear(RASTER_TRANSPARENT);
+
+		setRenderTarget(raster.dataPtr(), rasterWidth, rasterHeight, raster.getLineWidth() / sizeof(unsigned));
+		if (grid)
+		{
+			// 位图只有帧缓冲区的1 / gridSize²，直接在当前线程回放
+			setOrig(layout.origX, layout.origY);
+			setGridRasterTarget(true);
+			recordDisplayList(pCache->displayList, pVisible);
+			if (pVisible) pCache->displayList.replayItems(*pVisible, g_Painter);
+			else pCache->displayList.replay(g_Painter);
+			setGridRasterTarget(false);
+			setOrig(key.origX, key.origY);
+		}
+		else
+		{
+			drawDisplayList(pCache->displayList, pVisible);
+		}
+		setRenderTarget(NULL, 0, 0, 0);
+		if (clipped) setClipRect(clipX, clipY, clipWidth, clipHeight);
+
+		pCache->rasterKey = key;
+		pCache->rasterValid = true;
+	}
+
+	CompositeRect rect = getCompositeRect(width, height);
+	if (rect.width > 0 && rect.height > 0)
+	{
+		if (grid)
+		{
+			compositeGridRaster(raster, layout, key.gridSize, pBits, width, rect, pitch);
+		}
+		else
+		{
+			for (int y = rect.y; y < rect.y + rect.height; ++y)
+			{
+				_copyDWordsKeyed(pBits + y * pitch + rect.x, raster[y] + rect.x, rect.width, RASTER_TRANSPARENT);
+			}
+		}
+		int x, y, w, h;
+		if (!getClipRect(x, y, w, h)) addDirtyRect(0, 0, width, height);
+	}
+	if (!pLayer->cacheRaster) pCache->rasterValid = false;
+}
+
+void renderLayer(Layer* pLayer)
+{
+	setPenColor(pLayer->layerColor);
+
+	// 图层修改或视图改变后清空显示列表，之后按需记录可见的项，已记录的项重绘时直接回放
+	DisplayList& displayList = getRenderCache(pLayer)->displayList;
+	if (!displayList.isRecordedFrom(pLayer)) displayList.reset(pLayer);
+
+	int width, height, pitch;
+	unsigned* pBits = getFrameBuffer(width, height, pitch);
+	// 反走样的边缘要与下面已有的内容混合，不能先画到透明的缓存上再贴上去
+	// 网格模式总是先在网格分辨率的位图上绘制再放大，不缓存时每次重新绘制位图
+	bool grid = g_Painter.getPainterMode() == pmGrid;
+	if (((pLayer->cacheRaster && !g_Painter.isAntiAlias()) || grid) && pBits != NULL)
+	{
+		renderLayerRaster(getRenderCache(pLayer), pLayer, pBits, width, height, pitch);
+		return;
+	}
+
+	// 只绘制与可见区域（裁剪矩形，未设置时为整个绘制目标）相交的几何对象，分块绘制时各块也只绘制裁剪矩形内的部分
+	ClipWindow window;
+	bool visible = Clipper::getViewportWindow(window);
+	drawDisplayList(displayList, visible ? getVisibleItems(pLayer, window) : NULL);
+}
+
+void renderDataset(Dataset* pDataset)
+{
+	for (int i = 0, count = pDataset->getLayerCount(); i < count; ++i)
+	{
+		renderLayer((*pDataset)[i]);
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "GeoDefine.h"
+#include "ViewTransform.h"
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+class Painter;
+
+/// 操作类型，创建几何对象时记录在Geometry::operationType中，绘制时据此区分画线、画轮廓和填充
+enum OperationType {
+	otNone, otDrawRectangle, otDrawRectangleOutline,
+	otDrawLine, otDrawPolyline, otDrawPolygon, otDrawPolygonOutline,
+	otFillPolygon, // 新增填充多边形操作类型
+	otFillRectangle, // 新增填充矩形操作类型
+	otFillCircle, // 新增填充圆操作类型
+	otFillEllipse, // 新增填充椭圆操作类型
+	otDrawCircle, otDrawEllipse,
+	otDrawHoriLine, otDrawVertLine,
+	otDrawLineDDA, otDrawLineBresenham,
+	otClear,
+	otSelect // 选择几何对象：左键拉框框选，右键单击点选
+};
+
+/// 把单个几何对象转换为图元调用，target为Painter或DisplayList，二者有相同的绘制接口
+/// 几何对象的坐标为世界坐标，每个顶点按g_viewTransform变换到逻辑坐标后再生成图元
+/// 放大后超出保护带的线段、多边形、圆和椭圆先在双精度下裁剪再取整，与坐标轴平行的图元直接限制坐标
+template<class Target>
+void emitGeometry(Geometry* pGeometry, Target& target);
+
+/// 把列式存储中的一个几何对象转换为图元调用，不调用虚函数（见Layer::getColumns）
+template<class Target>
+void emitGeometry(const GeometryRecord& record, Target& target);
+
+/// 用painter绘制单个几何对象，多线程绘制时每个线程使用各自的Painter
+void renderGeometry(Geometry* pGeometry, Painter& painter);
+
+/// 用g_Painter绘制单个几何对象
+void renderGeometry(Geometry* pGeometry);
+
+/// 世界坐标的线段变换到像素：先在双精度下裁剪到保护带内再取整（见ViewTransform::getGuardBand），线段的方向不变
+/// @return 线段在保护带之外时返回false
+bool transformSegment(double x0, double y0, double x1, double y1, PixelPoint& p0, PixelPoint& p1);
+
+/// 世界坐标的环变换到像素后追加到out末尾，超出保护带时先在双精度下裁剪
+/// @return 追加的顶点数，环在保护带之外时为0
+int transformRing(const Point2D* pts, int count, std::vector<PixelPoint>& out);
+
+/// 超出保护带的椭圆（逻辑坐标，保留小数）折线化并裁剪到保护带内，取整后写入out
+/// @return 顶点数，与保护带不相交时为0
+int transformLargeEllipse(double cx, double cy, double rx, double ry, std::vector<PixelPoint>& out);
+
+/// 绘制图层中的所有几何对象，回放图层的显示列表，图层修改或视图改变后先重新记录（见DisplayList）
+/// 几何对象较多且有帧缓冲区时分块并行绘制（见TileRenderer）
+/// 图层开启cacheRaster时先绘制到图层的位图缓存，图层和绘制状态不变时重绘只合成位图
+/// 图层开启spatialIndex时用R树查询可见的几何对象，只记录和回放这些对象对应的项，平移、缩放后只需转换可见的对象
+void renderLayer(Layer* pLayer);
+
+/// 按图层顺序绘制数据集中的所有图层，后面的图层覆盖前面的图层
+void renderDataset(Dataset* pDataset);
+
+template<class Target>
+void emitGeometry(Geometry* pGeometry, Target& target)
+{
+	// 单个对象直接生成记录，坐标不复制，与按图层的列式存储绘制的结果相同
+	Point2D points[2];
+	thread_local vector<int> rings;
+	rings.clear();
+	emitGeometry(GeometryRecord::fromGeometry(pGeometry, points, rings), target);
+}
+
+template<class Target>
+void emitGeometry(const GeometryRecord& record, Target& target)
+{
+	const Point2D* pts = record.pts;
+	int ptsCount = record.count;
+	int opType = record.operationType;
+	const ViewTransform& view = g_viewTransform;
+
+	switch (record.type)
+	{
+	case gtPolyline:
+	{
+		if (opType == otDrawHoriLine && ptsCount >= 2) {
+			// 绘制水平线：保持y坐标不变，x坐标从起点到终点
+			PixelPoint first, last;
+			if (transformSegment(pts[0].x, pts[0].y, pts[ptsCount - 1].x, pts[0].y, first, last)) {
+				int x1 = first.x, x2 = last.x;
+				if (x1 > x2) std::swap(x1, x2);
+				target.drawLine(x1, first.y, x2, first.y);
+			}
+		}
+		else if (opType == otDrawVertLine && ptsCount >= 2) {
+			// 绘制垂直线：保持x坐标不变，y坐标从起点到终点
+			PixelPoint first, last;
+			if (transformSegment(pts[0].x, pts[0].y, pts[0].x, pts[ptsCount - 1].y, first, last)) {
+				int y1 = first.y, y2 = last.y;
+				if (y1 > y2) std::swap(y1, y2);
+				target.drawLine(first.x, y1, first.x, y2);
+			}
+		}
+		else if (opType == otDrawLineDDA) {
+			// 使用定点DDA算法绘制直线，保留端点变换后的小数部分
+			// 放大后端点可能超出24.8定点数的范围，先把线段裁剪到保护带内，方向不变
+			const ClipWindow guard = ViewTransform::getGuardBand();
+			double x0 = 0, y0 = 0, x1, y1, t0, t1;
+			if (ptsCount > 0) view.worldToLogical(pts[0].x, pts[0].y, x0, y0);
+			for (int i = 0; i < ptsCount - 1; ++i)
+			{
+				view.worldToLogical(pts[i + 1].x, pts[i + 1].y, x1, y1);
+				if (Clipper::clipLine(guard, x0, y0, x1, y1, t0, t1))
+				{
+					target.drawLineDDA(x0 + t0 * (x1 - x0), y0 + t0 * (y1 - y0), x0 + t1 * (x1 - x0), y0 + t1 * (y1 - y0));
+				}
+				x0 = x1;
+				y0 = y1;
+			}
+		}
+		/*else if (opType == otDrawLineBresenham) {
+			// 使用Bresenham算法绘制直线
+			for (int i = 0; i < ptsCount - 1; ++i)
+			{
+				target.drawLine(pts[i].x, pts[i].y, pts[(i + 1)].x, pts[(i + 1)].y);
+			}
+		}*/
+		else if (opType == otDrawRectangleOutline && ptsCount >= 4) {
+			// 矩形边框：首尾相连的折线，第0、2个点为对角点（见GeometryFactory::creatRectangleOutlineGeometry）
+			PixelPoint p0 = view.toPixel(pts[0].x, pts[0].y), p2 = view.toPixel(pts[2].x, pts[2].y);
+			target.drawRectangle(p0.x, p0.y, p2.x, p2.y);
+		}
+		else if (opType == otDrawPolyline && ptsCount >= 2) {
+			// 绘制折线：相邻的点连成线段，一起批量绘制，保护带外的线段不绘制
+			vector<PixelPoint> pairs(2 * (ptsCount - 1));
+			int segCount = 0;
+			for (int i = 0; i < ptsCount - 1; ++i)
+			{
+				if (transformSegment(pts[i].x, pts[i].y, pts[i + 1].x, pts[i + 1].y, pairs[2 * segCount], pairs[2 * segCount + 1])) ++segCount;
+			}
+			if (segCount > 0) target.drawLines(pairs.data(), segCount);
+		}
+	}
+	break;
+	case gtPolygon:
+	{
+		if (opType == otFillRectangle || (opType == otDrawRectangle && ptsCount >= 4)) {
+			// 矩形的4个顶点依次相连（见GeometryFactory::creatRectangleGeometry），第0、2个顶点为对角点
+			// 与坐标轴平行，限制对角点的坐标不改变窗口内的部分
+			if (ptsCount >= 4) {
+				PixelPoint p0 = view.toPixel(pts[0].x, pts[0].y), p2 = view.toPixel(pts[2].x, pts[2].y);
+				if (opType == otFillRectangle) target.fillRectangle(p0.x, p0.y, p2.x, p2.y);
+				else target.drawRectangle(p0.x, p0.y, p2.x, p2.y);
+			}
+			break;
+		}
+
+		// 各环分别变换并裁剪到保护带内，顶点数可能改变，重新计算各环的起始下标，去掉保护带外的环
+		vector<PixelPoint> _pts;
+		_pts.reserve(ptsCount);
+		vector<int> ringOffsets(1, 0);
+		for (int i = 0; i < record.ringCount; ++i) {
+			int first = record.ringOffsets[i];
+			if (transformRing(pts + first, record.ringOffsets[i + 1] - first, _pts) > 0) ringOffsets.push_back((int)_pts.size());
+		}
+		int ringCount = (int)ringOffsets.size() - 1;
+		if (ringCount == 0) break;
+
+		// 根据操作类型决定是绘制多边形轮廓还是填充多边形
+		if (opType == otFillPolygon) {
+			if (ringCount == 1 && record.fillRule == frEvenOdd) {
+				target.fillPolygon(_pts.data(), (int)_pts.size());
+			} else {
+				// 多个环一起填充，洞和重叠的部分由填充规则决定
+				target.fillPolyPolygon(_pts.data(), ringOffsets.data(), ringCount, record.fillRule);
+			}
+		} else {
+			// 各环分别画轮廓
+			for (int i = 0; i < ringCount; ++i) {
+				target.drawPolygon(_pts.data() + ringOffsets[i], ringOffsets[i + 1] - ringOffsets[i]);
+			}
+		}
+	}
+	break;
+	case gtCircle:
+	{
+		// 坐标为圆心和(r, r)，x、y方向比例相同，变换后仍为圆
+		double cx, cy, radius = pts[1].x * view.getScale();
+		view.worldToLogical(pts[0].x, pts[0].y, cx, cy);
+		if (!ViewTransform::inGuardBand(cx - radius, cy - radius) || !ViewTransform::inGuardBand(cx + radius, cy + radius)) {
+			// 超出保护带的圆半径很大，折线化后按多边形绘制
+			vector<PixelPoint> ring;
+			if (transformLargeEllipse(cx, cy, radius, radius, ring) >= 3) {
+				if (opType == otFillCircle) target.fillPolygon(ring.data(), (int)ring.size());
+				else target.drawPolygon(ring.data(), (int)ring.size());
+			}
+			break;
+		}
+		PixelPoint center = view.toPixel(pts[0].x, pts[0].y);
+		int x = center.x, y = center.y, r = view.toPixelLength(pts[1].x);
+
+		// 根据操作类型决定是绘制圆轮廓还是填充圆
+		if (opType == otFillCircle) {
+			target.fillCircle(x, y, r);
+		} else {
+			target.drawCircle(x, y, r);
+		}
+	}
+	break;
+	case gtEllipse:
+	{
+		// 坐标为两个对角点(x1, y1)、(x2, y2)，变换到像素后再求圆心和半径
+		double lx1, ly1, lx2, ly2;
+		view.worldToLogical(pts[0].x, pts[0].y, lx1, ly1);
+		view.worldToLogical(pts[1].x, pts[1].y, lx2, ly2);
+		if (!ViewTransform::inGuardBand(lx1, ly1) || !ViewTransform::inGuardBand(lx2, ly2)) {
+			// 超出保护带的椭圆折线化后按多边形绘制
+			vector<PixelPoint> ring;
+			if (transformLargeEllipse((lx1 + lx2) * 0.5, (ly1 + ly2) * 0.5, fabs(lx2 - lx1) * 0.5, fabs(ly2 - ly1) * 0.5, ring) >= 3) {
+				if (opType == otFillEllipse) target.fillPolygon(ring.data(), (int)ring.size());
+				else target.drawPolygon(ring.data(), (int)ring.size());
+			}
+			break;
+		}
+		PixelPoint p1 = view.toPixel(pts[0].x, pts[0].y), p2 = view.toPixel(pts[1].x, pts[1].y);
+		double x1 = p1.x, y1 = p1.y, x2 = p2.x, y2 = p2.y;
+
+		double centerX = (x1 + x2) * 0.5;
+		double centerY = (y1 + y2) * 0.5;
+		int radiusX = abs(x2 - x1) / 2;
+		int radiusY = abs(y2 - y1) / 2;
+		
+		// 根据操作类型决定是绘制椭圆轮廓还是填充椭圆
+		if (opType == otFillEllipse) {
+			target.fillEllipse(centerX, centerY, radiusX, radiusY);
+		} else {
+			target.drawEllipse(centerX, centerY, radiusX, radiusY);
+		}
+	}
+	break;
+	default:
+		break;
+	}
+}
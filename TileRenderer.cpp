@@ -0,0 +1,210 @@
+#include "TileRenderer.h"
+#include <algorithm>
+
+TileRenderer g_tileRenderer;
+
+TileRenderer::TileRenderer()
+{
+	threadCount = 0;
+	tileHeight = 0;
+	pDisplayList = NULL;
+	screenWidth = screenHeight = 0;
+	clipX0 = clipY0 = 0;
+	clipX1 = clipY1 = -1;
+	callerClipping = false;
+	rowsPerTile = 1;
+	tileCount = 0;
+	nextJob = 0;
+	painterMode = pmPixel;
+	gridSize = 1;
+	color = 0;
+	frame = 0;
+	busyWorkers = 0;
+	quit = false;
+
+	setThreadCount(0);
+}
+
+TileRenderer::~TileRenderer()
+{
+	stopWorkers();
+}
+
+void TileRenderer::setThreadCount(int count)
+{
+	if (count <= 0) count = (int)std::thread::hardware_concurrency();
+	if (count <= 0) count = 1;
+	if (count == threadCount) return;
+
+	stopWorkers();
+	threadCount = count;
+}
+
+void TileRenderer::startWorkers()
+{
+	quit = false;
+	for (int i = 1; i < threadCount; ++i)
+	{
+		workers.push_back(std::thread(&TileRenderer::workerMain, this, frame));
+	}
+}
+
+void TileRenderer::stopWorkers()
+{
+	if (workers.empty()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	startCond.notify_all();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void TileRenderer::workerMain(unsigned lastFrame)
+{
+	Painter painter;// 每个线程使用自己的Painter，Padding中的边表等缓冲区不能共享
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			startCond.wait(lock, [&] { return quit || frame != lastFrame; });
+			if (quit) return;
+			lastFrame = frame;
+		}
+
+		painter.setPainterMode(painterMode);
+		painter.setGridSize(gridSize);
+		painter.setPenColor(color);
+		painter.setAntiAlias(antiAlias);
+		renderTiles(painter);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busyWorkers == 0) doneCond.notify_one();
+		}
+	}
+}
+
+void TileRenderer::binItems(const std::vector<int>* pItems)
+{
+	int pitch;
+	getFrameBuffer(screenWidth, screenHeight, pitch);
+
+	int x, y, width, height;
+	callerClipping = getClipRect(x, y, width, height);
+	if (!callerClipping) x = 0, y = 0, width = screenWidth, height = screenHeight;
+	clipX0 = std::max(x, 0);
+	clipY0 = std::max(y, 0);
+	clipX1 = std::min(x + width, screenWidth) - 1;
+	clipY1 = std::min(y + height, screenHeight) - 1;
+
+	// 自动确定块高时每个线程约分到4块，块数多于线程数以平衡各块不同的工作量
+	rowsPerTile = tileHeight;
+	if (rowsPerTile <= 0) rowsPerTile = std::max(16, (screenHeight + threadCount * 4 - 1) / (threadCount * 4));
+	tileCount = (screenHeight + rowsPerTile - 1) / rowsPerTile;
+
+	bins.resize(tileCount);
+	for (size_t i = 0; i < bins.size(); ++i) bins[i].clear();
+	jobs.clear();
+	if (clipX0 > clipX1 || clipY0 > clipY1) return;
+
+	// 网格模式下图元按网格单元绘制，最多超出坐标范围约两个网格
+	int margin = painterMode == pmGrid ? 3 * gridSize : 1;
+
+	for (int k = 0, size = pItems ? (int)pItems->size() : pDisplayList->getItemCount(); k < size; ++k)
+	{
+		int i = pItems ? (*pItems)[k] : k;
+		int xmin, ymin, xmax, ymax;
+		if (!pDisplayList->getItemBounds(i, xmin, ymin, xmax, ymax)) continue;
+
+		int x0, y0, x1, y1;
+		LPtToDPt(xmin, ymin, x0, y0);
+		LPtToDPt(xmax, ymax, x1, y1);
+		if (x0 > x1) std::swap(x0, x1);
+		if (y0 > y1) std::swap(y0, y1);
+
+		if (x1 + margin < clipX0 || x0 - margin > clipX1) continue;
+		y0 = std::max(y0 - margin, clipY0);
+		y1 = std::min(y1 + margin, clipY1);
+		if (y0 > y1) continue;
+
+		for (int tile = y0 / rowsPerTile; tile <= y1 / rowsPerTile; ++tile)
+		{
+			std::vector<int>& bin = bins[tile];
+			if (bin.empty()) jobs.push_back(tile);
+			bin.push_back(i);
+		}
+	}
+}
+
+void TileRenderer::renderTiles(Painter& painter)
+{
+	for (;;)
+	{
+		int job = nextJob++;
+		if (job >= (int)jobs.size()) break;
+
+		int tile = jobs[job];
+		int y0 = std::max(tile * rowsPerTile, clipY0);
+		int y1 = std::min(tile * rowsPerTile + rowsPerTile - 1, clipY1);
+		setClipRect(clipX0, y0, clipX1 - clipX0 + 1, y1 - y0 + 1);
+
+		const std::vector<int>& bin = bins[tile];
+		for (size_t i = 0; i < bin.size(); ++i)
+		{
+			pDisplayList->replayItem(bin[i], painter);
+		}
+
+		resetClipRect();
+	}
+}
+
+void TileRenderer::render(DisplayList& displayList, const std::vector<int>* pItems)
+{
+	pDisplayList = &displayList;
+	painterMode = g_Painter.getPainterMode();
+	gridSize = g_Painter.getGridSize();
+	color = g_Painter.getPenColor();
+	antiAlias = g_Painter.isAntiAlias();
+
+	// 调用线程绘制各块时会改变自己的裁剪矩形，绘制完成后恢复
+	int callerX, callerY, callerWidth, callerHeight;
+	bool clipped = getClipRect(callerX, callerY, callerWidth, callerHeight);
+
+	binItems(pItems);
+	if (jobs.empty()) return;
+
+	if (workers.empty()) startWorkers();
+
+	nextJob = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		busyWorkers = (int)workers.size();
+		++frame;
+	}
+	startCond.notify_all();
+
+	// 调用线程也参与绘制，之后恢复调用者的裁剪矩形
+	renderTiles(g_Painter);
+	if (clipped) setClipRect(callerX, callerY, callerWidth, callerHeight);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCond.wait(lock, [&] { return busyWorkers == 0; });
+	}
+
+	// 工作线程在裁剪矩形下绘制，不更新已修改区域，这里统一提交；调用者设置了裁剪矩形时由调用者提交
+	if (callerClipping) return;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		int y = jobs[i] * rowsPerTile;
+		addDirtyRect(0, y, screenWidth, std::min(rowsPerTile, screenHeight - y));
+	}
+}
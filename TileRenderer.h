@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Painter.h"
+#include "DisplayList.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/// 分块并行绘制器：把屏幕按行分成等高的水平条带（块），按显示列表中各项的坐标范围把项分到所覆盖的块中，在工作线程池上并行回放各块
+/// 每块绘制时设置该块的裁剪矩形，块内按项在显示列表中的顺序回放，结果与顺序绘制完全相同
+/// 调用线程设置了裁剪矩形时各块只绘制与之相交的部分，与顺序绘制一样不更新已修改区域，由调用者提交
+/// 块取整行宽，扫描线填充只需计算块内的行，跨越多块的大对象重复的工作最少
+/// 需要帧缓冲区，DIRECT_DRAW模式下不能使用
+class TileRenderer
+{
+public:
+	TileRenderer();
+	~TileRenderer();
+
+	/// 设置参与绘制的线程数（包括调用render的线程），0表示使用CPU核数
+	void setThreadCount(int count);
+	int getThreadCount() const { return threadCount; }
+
+	/// 设置块的高度（像素），0表示按窗口高度和线程数自动确定
+	void setTileHeight(int height) { tileHeight = height > 0 ? height : 0; }
+	int getTileHeight() const { return tileHeight; }
+
+	/// 分块并行回放显示列表，使用g_Painter的绘制模式、网格大小和颜色，返回时已绘制完成
+	/// pItems不为NULL时只回放其中的项（序号从小到大），如空间索引查询到的可见对象
+	void render(DisplayList& displayList, const std::vector<int>* pItems = NULL);
+
+private:
+	/// 把显示列表中的项（pItems不为NULL时只取其中的项）按坐标范围分到所覆盖的块中，记录有项的块
+	void binItems(const std::vector<int>* pItems);
+
+	/// 依次领取并绘制剩余的块，直到全部领取完
+	void renderTiles(Painter& painter);
+
+	void startWorkers();
+	void stopWorkers();
+
+	/// 工作线程入口，lastFrame为创建线程时的帧序号，之后每开始新的一帧绘制一次
+	void workerMain(unsigned lastFrame);
+
+	int threadCount;
+	int tileHeight;
+
+	// 当前绘制的帧，render期间只读
+	DisplayList* pDisplayList;
+	int screenWidth, screenHeight;
+	int clipX0, clipY0, clipX1, clipY1;// 可绘制的设备坐标范围（包含端点），为调用者的裁剪矩形与屏幕的交集
+	bool callerClipping;// 调用线程是否设置了裁剪矩形
+	int rowsPerTile, tileCount;
+	std::vector<std::vector<int> > bins;// 每块中显示列表项的序号，按记录的顺序
+	std::vector<int> jobs;// 有几何对象的块
+	std::atomic<int> nextJob;// 下一个待领取的jobs下标
+	PainterMode painterMode;
+	int gridSize;
+	Color color;
+	bool antiAlias;
+
+	// 工作线程池，第一次绘制时创建
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable startCond;// 新的一帧开始
+	std::condition_variable doneCond;// 所有工作线程完成当前帧
+	unsigned frame;
+	int busyWorkers;
+	bool quit;
+};
+
+extern TileRenderer g_tileRenderer;
@@ -0,0 +1,46 @@
+#include "ViewTransform.h"
+#include <algorithm>
+
+///比例的上下限，超出后双精度坐标的有效位数不足以区分相邻像素
+const double MIN_SCALE = 1e-12;
+const double MAX_SCALE = 1e12;
+
+ViewTransform g_viewTransform;
+
+void ViewTransform::setTransform(double scale, double offsetX, double offsetY)
+{
+	this->scale = scale;
+	this->offsetX = offsetX;
+	this->offsetY = offsetY;
+	++version;
+}
+
+void ViewTransform::pan(double dx, double dy)
+{
+	setTransform(scale, offsetX + dx, offsetY + dy);
+}
+
+void ViewTransform::zoomAt(double x, double y, double factor)
+{
+	double newScale = std::min(std::max(scale * factor, MIN_SCALE), MAX_SCALE);
+
+	// (x - offset) / scale为(x, y)处的世界坐标，缩放后仍对应(x, y)
+	double ratio = newScale / scale;
+	setTransform(newScale, x - (x - offsetX) * ratio, y - (y - offsetY) * ratio);
+}
+
+void ViewTransform::zoomToExtent(double xmin, double ymin, double xmax, double ymax, const ClipWindow& window)
+{
+	double width = xmax - xmin, height = ymax - ymin;
+	double newScale = scale;
+	if (width > 0 || height > 0)
+	{
+		// 窗口包含两端的像素，宽度为xmax - xmin个像素间距
+		double sx = width > 0 ? (window.xmax - window.xmin) / width : MAX_SCALE;
+		double sy = height > 0 ? (window.ymax - window.ymin) / height : MAX_SCALE;
+		newScale = std::min(std::max(std::min(sx, sy), MIN_SCALE), MAX_SCALE);
+	}
+
+	double centerX = (window.xmin + window.xmax) * 0.5, centerY = (window.ymin + window.ymax) * 0.5;
+	setTransform(newScale, centerX - (xmin + xmax) * 0.5 * newScale, centerY - (ymin + ymax) * 0.5 * newScale);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Graphic.h"
+#include "Clipper.h"
+#include <math.h>
+
+/// 视图变换：世界坐标（几何对象的坐标）到逻辑坐标（像素）的缩放和平移，x、y方向的比例相同
+/// 逻辑坐标 = 世界坐标 × scale + offset，用双精度计算；生成图元时每个顶点变换一次（见emitGeometry），几何对象本身不变
+/// 默认为恒等变换，此时几何对象的坐标即为像素坐标
+class ViewTransform
+{
+public:
+	ViewTransform() : scale(1), offsetX(0), offsetY(0), version(0) {}
+
+	/// 每个世界坐标单位对应的像素数
+	double getScale() const { return scale; }
+
+	/// 每次修改变换后加1，按变换生成的显示列表、位图缓存据此判断是否失效
+	unsigned getVersion() const { return version; }
+
+	/// 设置变换：逻辑坐标 = 世界坐标 × scale + (offsetX, offsetY)，scale大于0
+	void setTransform(double scale, double offsetX, double offsetY);
+
+	/// 恢复为恒等变换
+	void reset() { setTransform(1, 0, 0); }
+
+	/// 平移视图，画面移动(dx, dy)个像素
+	void pan(double dx, double dy);
+
+	/// 以逻辑坐标(x, y)为中心缩放factor倍，该点对应的世界坐标不变；比例有上下限，避免坐标溢出或精度耗尽
+	void zoomAt(double x, double y, double factor);
+
+	/// 使世界坐标矩形[xmin, xmax] × [ymin, ymax]完整显示在逻辑坐标窗口window中并居中，矩形退化为点时只平移
+	void zoomToExtent(double xmin, double ymin, double xmax, double ymax, const ClipWindow& window);
+
+	/// 世界坐标到逻辑坐标，保留小数
+	void worldToLogical(double wx, double wy, double& x, double& y) const
+	{
+		x = wx * scale + offsetX;
+		y = wy * scale + offsetY;
+	}
+
+	/// 逻辑坐标到世界坐标
+	void logicalToWorld(double x, double y, double& wx, double& wy) const
+	{
+		wx = (x - offsetX) / scale;
+		wy = (y - offsetY) / scale;
+	}
+
+	/// 世界坐标对应的像素，四舍五入到最近的整数，超出范围的坐标限制在ClipWindow::unbounded()之内
+	/// 限制坐标会改变斜边的方向，只用于单独的点和与坐标轴平行的图元，其他图元先在双精度下裁剪到getGuardBand()之内再取整
+	PixelPoint toPixel(double wx, double wy) const
+	{
+		PixelPoint pt;
+		pt.x = roundToPixel(wx * scale + offsetX);
+		pt.y = roundToPixel(wy * scale + offsetY);
+		return pt;
+	}
+
+	/// 世界坐标的长度对应的像素数，四舍五入
+	int toPixelLength(double length) const { return roundToPixel(length * scale); }
+
+	/// 像素数对应的世界坐标长度
+	double toWorldLength(double length) const { return length / scale; }
+
+	/// 保护带：变换后的逻辑坐标先裁剪到该范围内再取整，远大于任何窗口，其边界不会显示
+	/// 范围内的坐标取整后不会溢出，也在定点DDA的24.8定点数范围内
+	static ClipWindow getGuardBand()
+	{
+		ClipWindow window = { -(1 << 22), -(1 << 22), 1 << 22, 1 << 22 };
+		return window;
+	}
+
+	/// 逻辑坐标的点是否在保护带内
+	static bool inGuardBand(double x, double y)
+	{
+		const double LIMIT = 1 << 22;
+		return x >= -LIMIT && x <= LIMIT && y >= -LIMIT && y <= LIMIT;
+	}
+
+	/// 逻辑坐标四舍五入到整数像素，限制在ClipWindow::unbounded()之内，缩放很大时远处的顶点不会使整数溢出
+	static int roundToPixel(double v)
+	{
+		const double LIMIT = 0x3FFFFFFF;
+		if (v > LIMIT) return 0x3FFFFFFF;
+		if (v < -LIMIT) return -0x3FFFFFFF;
+		return (int)floor(v + 0.5);
+	}
+
+	/// 逻辑坐标窗口对应的世界坐标范围
+	void getWorldWindow(const ClipWindow& window, double& xmin, double& ymin, double& xmax, double& ymax) const
+	{
+		logicalToWorld(window.xmin, window.ymin, xmin, ymin);
+		logicalToWorld(window.xmax, window.ymax, xmax, ymax);
+	}
+
+private:
+	double scale;
+	double offsetX, offsetY;
+	unsigned version;
+};
+
+/// 绘制使用的视图变换
+extern ViewTransform g_viewTransform;